@@ -2,18 +2,23 @@
 #  Copyright (c) 2013, Enthought, Inc.
 #  All rights reserved.
 #------------------------------------------------------------------------------
-from .atom import AtomMeta, Atom, observe, set_default
-from .catom import CAtom, Member, MemberChange, Event, Signal, null
+from .atom import AtomMeta, Atom, observe, set_default, layout_hint
+from .catom import (
+    CAtom, Member, MemberChange, ContainerChange, AtomList, AtomDict, Event, Signal, null,
+    notifications_deferred, set_notifications_deferred, flush_notifications, pending_notifications,
+    set_notification_hook, set_class_build_hook, set_access_profiling,
+)
 from .coerced import Coerced
 from .custom import CustomMember
 from .dict import Dict
 from .enum import Enum
 from .instance import Instance, ForwardInstance
 from .list import List
+from .pipeline import Pipeline
 from .property import CachedProperty
 from .scalars import (
     Value, ReadOnly, Constant, Bool, Int, Long, Float, Str, Unicode, Callable,
-    Range,
+    Range, LongRange, FloatRange, Round, Strip,
 )
 from .tuple import Tuple
 from .typed import Typed, ForwardTyped
@@ -42,6 +47,14 @@ from .catom import (
     VALIDATE_ENUM,
     VALIDATE_CALLABLE,
     VALIDATE_RANGE,
+    VALIDATE_LONG_RANGE,
+    VALIDATE_FLOAT_RANGE,
+    VALIDATE_COERCED,
+    VALIDATE_ROUND,
+    VALIDATE_STRIP,
+    VALIDATE_PIPELINE,
+    VALIDATE_STR_CONSTRAINED,
+    VALIDATE_UNICODE_CONSTRAINED,
     VALIDATE_OWNER_METHOD,
     USER_VALIDATE,
     NO_DEFAULT,
@@ -51,5 +64,12 @@ from .catom import (
     DEFAULT_FACTORY,
     DEFAULT_OWNER_METHOD,
     USER_DEFAULT,
+    FILTER_CROSSED,
+    FILTER_DELTA,
+    FILTER_BECAME,
+    COMPARE_EQUALITY,
+    COMPARE_IDENTITY,
+    COMPARE_NATIVE,
+    COMPARE_ALWAYS,
 )
 
@@ -2,12 +2,16 @@
 #  Copyright (c) 2013, Enthought, Inc.
 #  All rights reserved.
 #------------------------------------------------------------------------------
-from .catom import Member, DEFAULT_FACTORY, DEFAULT_VALUE, USER_VALIDATE
+from .catom import Member, DEFAULT_FACTORY, DEFAULT_VALUE, VALIDATE_COERCED
 
 
 class Coerced(Member):
     """ A member which will coerce a value to a given kind.
 
+    A value which is an instance of the kind is stored as-is. Any other
+    value is passed to the coercer, and a TypeError or ValueError raised
+    by the coercer is reported as a TypeError.
+
     """
     __slots__ = ()
 
@@ -34,22 +38,4 @@ class Coerced(Member):
             self.set_default_kind(DEFAULT_FACTORY, factory)
         else:
             self.set_default_kind(DEFAULT_VALUE, None)
-        self.set_validate_kind(USER_VALIDATE, (kind, coercer))
-
-    def validate(self, owner, name, old, new):
-        """ Validate the value of the member.
-
-        If the value is an instance of the allowable types, it will be
-        coerced to a value of the appropriate type.
-
-        """
-        kind, coercer = self.validate_kind[1]
-        if isinstance(new, kind):
-            return new
-        coercer = coercer or kind
-        try:
-            res = coercer(new)
-        except (TypeError, ValueError):
-            raise TypeError('could not coerce value an appopriate type')
-        return res
-
+        self.set_validate_kind(VALIDATE_COERCED, (kind, coercer))
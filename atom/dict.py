@@ -2,15 +2,19 @@
 #  Copyright (c) 2013, Enthought, Inc.
 #  All rights reserved.
 #------------------------------------------------------------------------------
-from UserDict import DictMixin
-
-from .catom import Member, null, DEFAULT_DICT, VALIDATE_DICT
+from .catom import Member, DEFAULT_DICT, VALIDATE_DICT
 from .instance import Instance
 
 
 class Dict(Member):
     """ A value of type `dict`.
 
+    The stored value is an `AtomDict` which validates the items added
+    to it with the key and value members, if given. Changes made to the
+    dict in-place are reported to the observers of the member with a
+    `ContainerChange`. Once the dict is replaced by another value it
+    behaves as a plain dict.
+
     """
     __slots__ = ()
 
@@ -76,67 +80,3 @@ class Dict(Member):
             key.set_member_index(index)
         if value is not None:
             value.set_member_index(index)
-
-    def __get__(self, owner, cls):
-        """ Get the dict object for the member.
-
-        If validation is enabled for the dict, a dict proxy will be
-        returned which will intercept method calls and perform the
-        required validation.
-
-        """
-        # XXX move this down to C++ by wrapping the list in a proxy
-        # during the validate method. Although, that will create a
-        # reference cycle to the owner, which should be avoided. So
-        # maybe wrapping on the fly is the better idea.
-        if owner is None:
-            return self
-        data = super(Dict, self).__get__(owner, cls)
-        key, value = self.validate_kind[1]
-        if key is None and value is None:
-            return data
-        return _DictProxy(owner, key, value, data)
-
-
-class _DictProxy(object, DictMixin):
-    """ A private proxy object which validates dict modifications.
-
-    Instances of this class should not be created by user code.
-
-    """
-    # XXX move this class down to C++
-    def __init__(self, owner, keymember, valmember, data):
-        self._owner = owner
-        self._keymember = keymember
-        self._valmember = valmember
-        self._data = data
-
-    def __getitem__(self, key):
-        return self._data[key]
-
-    def __setitem__(self, key, value):
-        owner = self._owner
-        if self._keymember is not None:
-            key = self._keymember.do_validate(owner, null, key)
-        if self._valmember is not None:
-            value = self._valmember.do_validate(owner, null, value)
-        self._data[key] = value
-
-    def __delitem__(self, key):
-        del self._data[key]
-
-    def __iter__(self):
-        return iter(self._data)
-
-    def __contains__(self, key):
-        return key in self._data
-
-    def keys(self):
-        return self._data.keys()
-
-    def copy(self):
-        return self._data.copy()
-
-    def has_key(self, key):
-        return key in self._data
-
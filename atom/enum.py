@@ -77,6 +77,24 @@ class Enum(Member):
         clone.set_validate_kind(VALIDATE_ENUM, newitems)
         return clone
 
+    def canonical(self):
+        """ Create a clone of the Enum which stores the matching item.
+
+        The clone stores the enum item which is equal to an assigned
+        value instead of the value itself. Equal values which are
+        distinct objects, such as strings read from a file, then share
+        the single item object held by the Enum.
+
+        Returns
+        -------
+        result : Enum
+            A new enum object with the same items and default.
+
+        """
+        clone = self.clone()
+        clone.set_enum_canonical(True)
+        return clone
+
     def __call__(self, item):
         """ Create a clone of the Enum item with a new default.
 
@@ -118,19 +118,18 @@ class ForwardInstance(Instance):
     def validate(self, owner, name, old, new):
         """ Called to validate the value.
 
-        This will resolve the type and validate the new value. It will
-        then update the internal default and validate handlers to behave
-        like a normal instance member.
+        This will resolve the type and update the internal default and
+        validate handlers to behave like a normal instance member. The
+        new value is then validated by the instance handler, which also
+        caches the accepted type.
 
         """
         resolve = self.validate_kind[1]
         kind = resolve()
-        if not isinstance(new, kind):
-            raise TypeError('invalid instance type')
         self.set_validate_kind(VALIDATE_INSTANCE, kind)
         if self.default_kind[0] == USER_DEFAULT:
             args, kwargs = self.default_kind[1]
             factory = lambda: kind(*args, **kwargs)
             self.set_default_kind(DEFAULT_FACTORY, factory)
-        return new
+        return self.do_validate(owner, old, new)
 
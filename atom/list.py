@@ -2,7 +2,7 @@
 #  Copyright (c) 2013, Enthought, Inc.
 #  All rights reserved.
 #------------------------------------------------------------------------------
-from .catom import Member, null, DEFAULT_LIST, VALIDATE_LIST
+from .catom import Member, DEFAULT_LIST, VALIDATE_LIST
 from .instance import Instance
 
 
@@ -13,6 +13,13 @@ class List(Member):
     unmodified. This is similar to the semantics of the assignment
     operator on the C++ STL container classes.
 
+    The stored value is an `AtomList` which validates the items added
+    to it with the item member, if given. Changes made to the list
+    in-place are reported to the observers of the member with a
+    `ContainerChange`, whose kind is 'insert', 'remove', 'replace' or
+    'reset' and whose key is the index or slice which changed. Once the
+    list is replaced by another value it behaves as a plain list.
+
     """
     __slots__ = '_member'
 
@@ -68,82 +75,3 @@ class List(Member):
         member = self.validate_kind[1]
         if member is not None:
             member.set_member_index(index)
-
-    def __get__(self, owner, cls):
-        """ Get the list object for the member.
-
-        If validation is enabled for the list items, a list proxy will
-        be returned which will intercept method calls and perform the
-        required validation.
-
-        """
-        # XXX move this down to C++ by wrapping the list in a proxy
-        # during the validate method. Although, that will create a
-        # reference cycle to the owner, which should be avoided. So
-        # maybe wrapping on the fly is the better idea.
-        if owner is None:
-            return self
-        data = super(List, self).__get__(owner, cls)
-        member = self.validate_kind[1]
-        if member is None:
-            return data
-        return _ListProxy(owner, member, data)
-
-
-class _ListProxy(object):
-    """ A private proxy object which validates list modifications.
-
-    Instances of this class should not be created by user code.
-
-    """
-    # XXX move this class down to C++
-    def __init__(self, owner, member, data):
-        self._owner = owner
-        self._member = member
-        self._data = data
-
-    def __repr__(self):
-        return repr(self._data)
-
-    def __call__(self):
-        return self._data
-
-    def __iter__(self):
-        return iter(self._data)
-
-    def __getitem__(self, index):
-        return self._data[index]
-
-    def __setitem__(self, index, item):
-        item = self._member.do_validate(self._owner, null, item)
-        self._data[index] = item
-
-    def __delitem__(self, index):
-        del self._data[index]
-
-    def append(self, item):
-        item = self._member.do_validate(self._owner, null, item)
-        self._data.append(item)
-
-    def insert(self, index, item):
-        item = self._member.do_validate(self._owner, null, item)
-        self._data.insert(index, item)
-
-    def extend(self, items):
-        owner = self._owner
-        validate = self._member.do_validate
-        items = [validate(owner, null, item) for item in items]
-        self._data.extend(items)
-
-    def pop(self, *args):
-        self._data.pop(*args)
-
-    def remove(self, item):
-        self._data.remove(item)
-
-    def reverse(self):
-        self._data.reverse()
-
-    def sort(self, *args, **kwargs):
-        self._data.sort(*args, **kwargs)
-
@@ -0,0 +1,77 @@
+#------------------------------------------------------------------------------
+#  Copyright (c) 2013, Enthought, Inc.
+#  All rights reserved.
+#------------------------------------------------------------------------------
+from .catom import Member, VALIDATE_PIPELINE
+from .scalars import Value
+
+
+class Pipeline(Value):
+    """ A value which is validated by a sequence of members.
+
+    The value is passed through the validate kind of each step member
+    in turn, and the result of the last step is stored. The steps run
+    in a single native loop, so a chain such as a float promotion, a
+    range check and a rounding needs no Python validate method. Only
+    the validate kind of a step is used; its default, post validation
+    and observers are ignored.
+
+    """
+    __slots__ = ()
+
+    def __init__(self, *steps, **kwargs):
+        """ Initialize a Pipeline.
+
+        Parameters
+        ----------
+        *steps
+            The members which validate the value, in order.
+
+        default : object, optional
+            The default value for the member.
+
+        factory : callable, optional
+            A callable object which is called with zero arguments and
+            returns a default value for the member.
+
+        """
+        for step in steps:
+            if not isinstance(step, Member):
+                raise TypeError('bad Pipeline step')
+        default = kwargs.pop('default', None)
+        factory = kwargs.pop('factory', None)
+        if kwargs:
+            raise TypeError('unexpected keyword arguments: %s' % kwargs.keys())
+        super(Pipeline, self).__init__(default, factory)
+        self.set_validate_kind(VALIDATE_PIPELINE, steps)
+
+    @property
+    def steps(self):
+        """ Get the tuple of step members of the pipeline.
+
+        """
+        return self.validate_kind[1]
+
+    def set_member_name(self, name):
+        """ Assign the name to this member.
+
+        This method is called by the Atom metaclass when a class is
+        created. The steps share the name so that their validation
+        errors refer to this member.
+
+        """
+        super(Pipeline, self).set_member_name(name)
+        for step in self.steps:
+            step.set_member_name(name)
+
+    def set_member_index(self, index):
+        """ Assign the index to this member.
+
+        This method is called by the Atom metaclass when a class is
+        created. This makes sure the index of the step members is
+        also updated.
+
+        """
+        super(Pipeline, self).set_member_index(index)
+        for step in self.steps:
+            step.set_member_index(index)
@@ -2,12 +2,16 @@
 #  Copyright (c) 2013, Enthought, Inc.
 #  All rights reserved.
 #------------------------------------------------------------------------------
+import re
+
 from .catom import (
     Member, DEFAULT_FACTORY, DEFAULT_VALUE, VALIDATE_READ_ONLY,
     VALIDATE_CONSTANT, VALIDATE_CALLABLE, VALIDATE_BOOL, VALIDATE_INT,
     VALIDATE_LONG, VALIDATE_FLOAT, VALIDATE_FLOAT_PROMOTE, VALIDATE_STR,
     VALIDATE_UNICODE, VALIDATE_UNICODE_PROMOTE, VALIDATE_LONG_PROMOTE,
-    VALIDATE_RANGE,
+    VALIDATE_RANGE, VALIDATE_LONG_RANGE, VALIDATE_FLOAT_RANGE, VALIDATE_ROUND,
+    VALIDATE_STRIP, VALIDATE_STR_CONSTRAINED, VALIDATE_UNICODE_CONSTRAINED,
+    COMPARE_NATIVE,
 )
 
 
@@ -88,6 +92,7 @@ class Bool(Value):
         super(Bool, self).__init__(default, factory)
         self.set_validate_kind(VALIDATE_BOOL, None)
         self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
 
 
 class Int(Value):
@@ -100,6 +105,7 @@ class Int(Value):
         super(Int, self).__init__(default, factory)
         self.set_validate_kind(VALIDATE_INT, None)
         self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
 
 
 class Long(Value):
@@ -123,10 +129,14 @@ class Long(Value):
 class Range(Value):
     """ An integer value clipped to a range.
 
+    A value outside of the range is rejected, unless clamp=True is
+    passed to the constructor, in which case it is replaced with the
+    nearest bound.
+
     """
     __slots__ = ()
 
-    def __init__(self, low=None, high=None, value=None):
+    def __init__(self, low=None, high=None, value=None, clamp=False):
         if low is not None and high is not None and low > high:
             low, high = high, low
         default = 0
@@ -137,8 +147,61 @@ class Range(Value):
         elif high is not None:
             default = high
         self.set_default_kind(DEFAULT_VALUE, default)
-        self.set_validate_kind(VALIDATE_RANGE, (low, high))
+        self.set_validate_kind(VALIDATE_RANGE, (low, high, clamp))
+        self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
+
+
+class LongRange(Value):
+    """ A long value clipped to a range.
+
+    Ints are promoted to longs. The bounds must fit in a C long. A
+    value outside of the range is rejected, unless clamp=True is passed
+    to the constructor, in which case it is replaced with the nearest
+    bound.
+
+    """
+    __slots__ = ()
+
+    def __init__(self, low=None, high=None, value=None, clamp=False):
+        if low is not None and high is not None and low > high:
+            low, high = high, low
+        default = 0L
+        if value is not None:
+            default = value
+        elif low is not None:
+            default = low
+        elif high is not None:
+            default = high
+        self.set_default_kind(DEFAULT_VALUE, long(default))
+        self.set_validate_kind(VALIDATE_LONG_RANGE, (low, high, clamp))
+        self.set_validate_default(True)
+
+
+class FloatRange(Value):
+    """ A float value clipped to a range.
+
+    Ints and longs are promoted to floats. A value outside of the range
+    is rejected, unless clamp=True is passed to the constructor, in
+    which case it is replaced with the nearest bound.
+
+    """
+    __slots__ = ()
+
+    def __init__(self, low=None, high=None, value=None, clamp=False):
+        if low is not None and high is not None and low > high:
+            low, high = high, low
+        default = 0.0
+        if value is not None:
+            default = value
+        elif low is not None:
+            default = low
+        elif high is not None:
+            default = high
+        self.set_default_kind(DEFAULT_VALUE, float(default))
+        self.set_validate_kind(VALIDATE_FLOAT_RANGE, (low, high, clamp))
         self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
 
 
 class Float(Value):
@@ -157,18 +220,41 @@ class Float(Value):
         else:
             self.set_validate_kind(VALIDATE_FLOAT_PROMOTE, None)
         self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
+
+
+def _string_constraints(min_len, max_len, pattern, intern):
+    """ Get the constraints of a string value, or None if unconstrained.
+
+    """
+    if min_len is None and max_len is None and pattern is None and not intern:
+        return None
+    if pattern is not None:
+        pattern = re.compile(pattern)
+    return (min_len, max_len, pattern, intern)
 
 
 class Str(Value):
     """ A value of type `str`.
 
+    The length of the value may be bounded by min_len and max_len, and
+    the value may be required to match a pattern. The pattern is matched
+    at the start of the value, as with `re.match`. Pass intern=True to
+    intern the stored value, so that equal values share one object.
+
     """
     __slots__ = ()
 
-    def __init__(self, default='', factory=None):
+    def __init__(self, default='', factory=None, min_len=None, max_len=None,
+                 pattern=None, intern=False):
         super(Str, self).__init__(default, factory)
-        self.set_validate_kind(VALIDATE_STR, None)
+        context = _string_constraints(min_len, max_len, pattern, intern)
+        if context is None:
+            self.set_validate_kind(VALIDATE_STR, None)
+        else:
+            self.set_validate_kind(VALIDATE_STR_CONSTRAINED, context)
         self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
 
 
 class Unicode(Value):
@@ -177,14 +263,54 @@ class Unicode(Value):
     By default, plain strings will be promoted to unicode strings. Pass
     strict=True to the constructor to enable strict unicode checking.
 
+    The min_len, max_len and pattern constraints are the same as those
+    of `Str`. Since unicode has no builtin interning, an interned value
+    is shared through a table held by the member. The values which are
+    no longer referenced elsewhere are dropped from the table as it
+    grows.
+
     """
     __slots__ = ()
 
-    def __init__(self, default=u'', factory=None, strict=False):
+    def __init__(self, default=u'', factory=None, strict=False, min_len=None,
+                 max_len=None, pattern=None, intern=False):
         super(Unicode, self).__init__(default, factory)
-        if strict:
+        context = _string_constraints(min_len, max_len, pattern, intern)
+        if context is not None:
+            context += (not strict,)
+            self.set_validate_kind(VALIDATE_UNICODE_CONSTRAINED, context)
+        elif strict:
             self.set_validate_kind(VALIDATE_UNICODE, None)
         else:
             self.set_validate_kind(VALIDATE_UNICODE_PROMOTE, None)
         self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
+
 
+class Round(Value):
+    """ A float value rounded to a number of decimal digits.
+
+    Ints and longs are promoted to floats. The rounding is the same
+    as that of the builtin `round`.
+
+    """
+    __slots__ = ()
+
+    def __init__(self, digits=0, default=0.0, factory=None):
+        super(Round, self).__init__(default, factory)
+        self.set_validate_kind(VALIDATE_ROUND, digits)
+        self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
+
+
+class Strip(Value):
+    """ A `str` or `unicode` value with surrounding whitespace removed.
+
+    """
+    __slots__ = ()
+
+    def __init__(self, default='', factory=None):
+        super(Strip, self).__init__(default, factory)
+        self.set_validate_kind(VALIDATE_STRIP, None)
+        self.set_validate_default(True)
+        self.set_compare_kind(COMPARE_NATIVE)
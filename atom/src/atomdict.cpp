@@ -0,0 +1,445 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#include "atomdict.h"
+#include "containerchange.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+static PyObject* _keys_str;
+
+
+static PyObject* _dict_pop;
+
+
+static PyObject* _dict_popitem;
+
+
+static PyObject*
+validate_with( AtomDict* self, Member* validator, PyObject* item )
+{
+    if( !validator || !self->owner )
+        return newref( item );
+    PyObject* owner = reinterpret_cast<PyObject*>( self->owner );
+    return member_validate( validator, owner, _py_null, item );
+}
+
+
+// Validate the items of the source dict into the destination dict.
+static int
+validate_items( AtomDict* self, PyObject* source, PyObject* dest )
+{
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while( PyDict_Next( source, &pos, &key, &value ) )
+    {
+        PyObjectPtr validkey( validate_with( self, self->key_validator, key ) );
+        if( !validkey )
+            return -1;
+        PyObjectPtr validvalue( validate_with( self, self->value_validator, value ) );
+        if( !validvalue )
+            return -1;
+        if( PyDict_SetItem( dest, validkey.get(), validvalue.get() ) < 0 )
+            return -1;
+    }
+    return 0;
+}
+
+
+// Return the atom to notify of a change to the dict, or null.
+static inline CAtom*
+observer_atom( AtomDict* self )
+{
+    return container_observer_atom(
+        self->member, self->owner, reinterpret_cast<PyObject*>( self ) );
+}
+
+
+// Report a change to the value of a key. The old and new values may
+// be null for an insertion or a removal.
+static int
+notify_key( AtomDict* self, PyObject* key, PyObject* oldvalue, PyObject* newvalue )
+{
+    CAtom* atom = observer_atom( self );
+    if( !atom )
+        return 0;
+    PyObject* kind = !oldvalue ? _insert_str : !newvalue ? _remove_str : _replace_str;
+    return container_notify( self->member, atom, kind, key, oldvalue, newvalue );
+}
+
+
+// Invoke a method of the dict type as an unbound method.
+static PyObject*
+call_dict_method( PyObject* method, AtomDict* self, PyObject* args )
+{
+    PyObjectPtr methargs( PyTuple_New( PyTuple_GET_SIZE( args ) + 1 ) );
+    if( !methargs )
+        return 0;
+    PyTuple_SET_ITEM( methargs.get(), 0, newref( reinterpret_cast<PyObject*>( self ) ) );
+    for( Py_ssize_t i = 0; i < PyTuple_GET_SIZE( args ); ++i )
+        PyTuple_SET_ITEM( methargs.get(), i + 1, newref( PyTuple_GET_ITEM( args, i ) ) );
+    return PyObject_Call( method, methargs.get(), 0 );
+}
+
+
+PyObject*
+AtomDict_New( Member* member, Member* key_validator, Member* value_validator )
+{
+    // The dict type initializes the hash table in tp_new.
+    PyObjectPtr args( PyTuple_New( 0 ) );
+    if( !args )
+        return 0;
+    PyObject* pyself = PyDict_Type.tp_new( &AtomDict_Type, args.get(), 0 );
+    if( !pyself )
+        return 0;
+    AtomDict* self = reinterpret_cast<AtomDict*>( pyself );
+    self->member = reinterpret_cast<Member*>(
+        xnewref( reinterpret_cast<PyObject*>( member ) ) );
+    self->key_validator = reinterpret_cast<Member*>(
+        xnewref( reinterpret_cast<PyObject*>( key_validator ) ) );
+    self->value_validator = reinterpret_cast<Member*>(
+        xnewref( reinterpret_cast<PyObject*>( value_validator ) ) );
+    self->owner = 0;
+    self->validated = false;
+    return pyself;
+}
+
+
+static int
+AtomDict_clear( AtomDict* self )
+{
+    Py_CLEAR( self->member );
+    Py_CLEAR( self->key_validator );
+    Py_CLEAR( self->value_validator );
+    return PyDict_Type.tp_clear( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static int
+AtomDict_traverse( AtomDict* self, visitproc visit, void* arg )
+{
+    Py_VISIT( self->member );
+    Py_VISIT( self->key_validator );
+    Py_VISIT( self->value_validator );
+    return PyDict_Type.tp_traverse( reinterpret_cast<PyObject*>( self ), visit, arg );
+}
+
+
+static void
+AtomDict_dealloc( AtomDict* self )
+{
+    Py_CLEAR( self->member );
+    Py_CLEAR( self->key_validator );
+    Py_CLEAR( self->value_validator );
+    PyDict_Type.tp_dealloc( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static int
+AtomDict_ass_subscript( AtomDict* self, PyObject* key, PyObject* value )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    // The old value is only looked up when the change is observed.
+    bool observed = observer_atom( self ) != 0;
+    if( !value )
+    {
+        PyObjectPtr oldvalue;
+        if( observed )
+            oldvalue = xnewref( PyDict_GetItem( pyself, key ) );
+        if( PyDict_DelItem( pyself, key ) < 0 )
+            return -1;
+        if( !observed )
+            return 0;
+        return notify_key( self, key, oldvalue.get(), 0 );
+    }
+    PyObjectPtr validkey( validate_with( self, self->key_validator, key ) );
+    if( !validkey )
+        return -1;
+    PyObjectPtr validvalue( validate_with( self, self->value_validator, value ) );
+    if( !validvalue )
+        return -1;
+    PyObjectPtr oldvalue;
+    if( observed )
+        oldvalue = xnewref( PyDict_GetItem( pyself, validkey.get() ) );
+    if( PyDict_SetItem( pyself, validkey.get(), validvalue.get() ) < 0 )
+        return -1;
+    if( !observed )
+        return 0;
+    return notify_key( self, validkey.get(), oldvalue.get(), validvalue.get() );
+}
+
+
+static PyObject*
+AtomDict_setdefault( AtomDict* self, PyObject* args )
+{
+    PyObject* key;
+    PyObject* value = Py_None;
+    if( !PyArg_UnpackTuple( args, "setdefault", 1, 2, &key, &value ) )
+        return 0;
+    PyObjectPtr validkey( validate_with( self, self->key_validator, key ) );
+    if( !validkey )
+        return 0;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    PyObject* current = PyDict_GetItem( pyself, validkey.get() );  // borrowed
+    if( current )
+        return newref( current );
+    PyObjectPtr validvalue( validate_with( self, self->value_validator, value ) );
+    if( !validvalue )
+        return 0;
+    if( PyDict_SetItem( pyself, validkey.get(), validvalue.get() ) < 0 )
+        return 0;
+    if( notify_key( self, validkey.get(), 0, validvalue.get() ) < 0 )
+        return 0;
+    return validvalue.release();
+}
+
+
+static PyObject*
+AtomDict_update( AtomDict* self, PyObject* args, PyObject* kwargs )
+{
+    PyObject* other = 0;
+    if( !PyArg_UnpackTuple( args, "update", 0, 1, &other ) )
+        return 0;
+    // The items are collected and validated before the dict is changed,
+    // so a failed validation leaves the dict unmodified.
+    PyObjectPtr items( PyDict_New() );
+    if( !items )
+        return 0;
+    if( other )
+    {
+        int res;
+        if( PyObject_HasAttr( other, _keys_str ) )
+            res = PyDict_Merge( items.get(), other, 1 );
+        else
+            res = PyDict_MergeFromSeq2( items.get(), other, 1 );
+        if( res < 0 )
+            return 0;
+    }
+    if( kwargs && PyDict_Merge( items.get(), kwargs, 1 ) < 0 )
+        return 0;
+    PyObjectPtr valid( PyDict_New() );
+    if( !valid )
+        return 0;
+    if( validate_items( self, items.get(), valid.get() ) < 0 )
+        return 0;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    if( !observer_atom( self ) )
+    {
+        if( PyDict_Merge( pyself, valid.get(), 1 ) < 0 )
+            return 0;
+        Py_RETURN_NONE;
+    }
+    // Collect the replaced values so that each key can be reported
+    // once the whole update has been applied.
+    PyObjectPtr oldvalues( PyDict_New() );
+    if( !oldvalues )
+        return 0;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while( PyDict_Next( valid.get(), &pos, &key, &value ) )
+    {
+        PyObject* oldvalue = PyDict_GetItem( pyself, key );  // borrowed
+        if( oldvalue && PyDict_SetItem( oldvalues.get(), key, oldvalue ) < 0 )
+            return 0;
+    }
+    if( PyDict_Merge( pyself, valid.get(), 1 ) < 0 )
+        return 0;
+    pos = 0;
+    while( PyDict_Next( valid.get(), &pos, &key, &value ) )
+    {
+        if( notify_key( self, key, PyDict_GetItem( oldvalues.get(), key ), value ) < 0 )
+            return 0;
+    }
+    Py_RETURN_NONE;
+}
+
+
+// The base dict __init__ updates the dict without validation, so it is
+// routed through the validated update.
+static int
+AtomDict_init( AtomDict* self, PyObject* args, PyObject* kwargs )
+{
+    PyObjectPtr res( AtomDict_update( self, args, kwargs ) );
+    return res ? 0 : -1;
+}
+
+
+static PyObject*
+AtomDict_pop( AtomDict* self, PyObject* args )
+{
+    PyObject* key;
+    PyObject* deflt = 0;
+    if( !PyArg_UnpackTuple( args, "pop", 1, 2, &key, &deflt ) )
+        return 0;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    int present = 0;
+    if( observer_atom( self ) )
+    {
+        present = PyDict_Contains( pyself, key );
+        if( present < 0 )
+            return 0;
+    }
+    PyObjectPtr value( call_dict_method( _dict_pop, self, args ) );
+    if( !value )
+        return 0;
+    if( present && notify_key( self, key, value.get(), 0 ) < 0 )
+        return 0;
+    return value.release();
+}
+
+
+static PyObject*
+AtomDict_popitem( AtomDict* self )
+{
+    PyObjectPtr args( PyTuple_New( 0 ) );
+    if( !args )
+        return 0;
+    PyObjectPtr item( call_dict_method( _dict_popitem, self, args.get() ) );
+    if( !item )
+        return 0;
+    PyObject* key = PyTuple_GET_ITEM( item.get(), 0 );
+    PyObject* value = PyTuple_GET_ITEM( item.get(), 1 );
+    if( notify_key( self, key, value, 0 ) < 0 )
+        return 0;
+    return item.release();
+}
+
+
+static PyObject*
+AtomDict_clear_items( AtomDict* self )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    CAtom* atom = observer_atom( self );
+    if( !atom || PyDict_Size( pyself ) == 0 )
+    {
+        PyDict_Clear( pyself );
+        Py_RETURN_NONE;
+    }
+    PyObjectPtr oldvalues( PyDict_Copy( pyself ) );
+    if( !oldvalues )
+        return 0;
+    PyDict_Clear( pyself );
+    atom = observer_atom( self );
+    if( atom && container_notify( self->member, atom, _reset_str, 0, oldvalues.get(), pyself ) < 0 )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+AtomDict_reduce( AtomDict* self )
+{
+    // Pickle and copy as a plain dict. The owner validates the dict
+    // again when the value is restored.
+    PyObjectPtr items( PyDict_Copy( reinterpret_cast<PyObject*>( self ) ) );
+    if( !items )
+        return 0;
+    return Py_BuildValue( "(O(O))", &PyDict_Type, items.get() );
+}
+
+
+static PyMethodDef
+AtomDict_methods[] = {
+    { "setdefault", ( PyCFunction )AtomDict_setdefault, METH_VARARGS,
+      "D.setdefault(k[,d]) -> D.get(k,d), also set D[k]=d if k not in D, validating k and d" },
+    { "update", ( PyCFunction )AtomDict_update, METH_VARARGS | METH_KEYWORDS,
+      "D.update([E, ]**F) -> None.  Update D from dict/iterable E and F, validating the items." },
+    { "pop", ( PyCFunction )AtomDict_pop, METH_VARARGS,
+      "D.pop(k[,d]) -> v, remove specified key and return the corresponding value" },
+    { "popitem", ( PyCFunction )AtomDict_popitem, METH_NOARGS,
+      "D.popitem() -> (k, v), remove and return some (key, value) pair as a 2-tuple" },
+    { "clear", ( PyCFunction )AtomDict_clear_items, METH_NOARGS,
+      "D.clear() -> None.  Remove all items from D." },
+    { "__reduce__", ( PyCFunction )AtomDict_reduce, METH_NOARGS,
+      "Reduce the dict to a plain dict for pickling and copying." },
+    { 0 } // sentinel
+};
+
+
+PyMappingMethods AtomDict_as_mapping = {
+    (lenfunc)0,                             /* mp_length */
+    (binaryfunc)0,                          /* mp_subscript */
+    (objobjargproc)AtomDict_ass_subscript   /* mp_ass_subscript */
+};
+
+
+PyTypeObject AtomDict_Type = {
+    PyObject_HEAD_INIT( &PyType_Type )
+    0,                                      /* ob_size */
+    "catom.AtomDict",                       /* tp_name */
+    sizeof( AtomDict ),                     /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    (destructor)AtomDict_dealloc,           /* tp_dealloc */
+    (printfunc)0,                           /* tp_print */
+    (getattrfunc)0,                         /* tp_getattr */
+    (setattrfunc)0,                         /* tp_setattr */
+    (cmpfunc)0,                             /* tp_compare */
+    (reprfunc)0,                            /* tp_repr */
+    (PyNumberMethods*)0,                    /* tp_as_number */
+    (PySequenceMethods*)0,                  /* tp_as_sequence */
+    (PyMappingMethods*)&AtomDict_as_mapping, /* tp_as_mapping */
+    (hashfunc)0,                            /* tp_hash */
+    (ternaryfunc)0,                         /* tp_call */
+    (reprfunc)0,                            /* tp_str */
+    (getattrofunc)0,                        /* tp_getattro */
+    (setattrofunc)0,                        /* tp_setattro */
+    (PyBufferProcs*)0,                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    "A dict which validates the items added to it and reports its changes.", /* Documentation string */
+    (traverseproc)AtomDict_traverse,        /* tp_traverse */
+    (inquiry)AtomDict_clear,                /* tp_clear */
+    (richcmpfunc)0,                         /* tp_richcompare */
+    0,                                      /* tp_weaklistoffset */
+    (getiterfunc)0,                         /* tp_iter */
+    (iternextfunc)0,                        /* tp_iternext */
+    (struct PyMethodDef*)AtomDict_methods,  /* tp_methods */
+    (struct PyMemberDef*)0,                 /* tp_members */
+    0,                                      /* tp_getset */
+    &PyDict_Type,                           /* tp_base */
+    0,                                      /* tp_dict */
+    (descrgetfunc)0,                        /* tp_descr_get */
+    (descrsetfunc)0,                        /* tp_descr_set */
+    0,                                      /* tp_dictoffset */
+    (initproc)AtomDict_init,                /* tp_init */
+    (allocfunc)0,                           /* tp_alloc */
+    (newfunc)0,                             /* tp_new */
+    (freefunc)0,                            /* tp_free */
+    (inquiry)0,                             /* tp_is_gc */
+    0,                                      /* tp_bases */
+    0,                                      /* tp_mro */
+    0,                                      /* tp_cache */
+    0,                                      /* tp_subclasses */
+    0,                                      /* tp_weaklist */
+    (destructor)0                           /* tp_del */
+};
+
+
+int
+import_atomdict()
+{
+    if( PyType_Ready( &AtomDict_Type ) < 0 )
+        return -1;
+    _keys_str = PyString_InternFromString( "keys" );
+    if( !_keys_str )
+        return -1;
+    _dict_pop = PyDict_GetItemString( PyDict_Type.tp_dict, "pop" );
+    if( !_dict_pop )
+        return -1;
+    Py_INCREF( _dict_pop );
+    _dict_popitem = PyDict_GetItemString( PyDict_Type.tp_dict, "popitem" );
+    if( !_dict_popitem )
+        return -1;
+    Py_INCREF( _dict_popitem );
+    return 0;
+}
+
+
+}  // extern C
@@ -0,0 +1,48 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+#include "catom.h"
+#include "member.h"
+
+
+extern "C" {
+
+
+// A dict subclass which validates the keys and values added to it with
+// the key and value members of a Dict, and which reports its in-place
+// changes in the same way as an AtomList. The owner atom is held in the
+// same way as for an AtomList.
+typedef struct {
+    PyDictObject dict;
+    Member* member;
+    Member* key_validator;
+    Member* value_validator;
+    CAtom* owner;
+    bool validated;  // every item was validated by the validators
+} AtomDict;
+
+
+// Create a new empty dict. The member and either validator may be null.
+// The dict is not owned until it is stored, and is not marked as
+// validated, which is left to the caller.
+PyObject*
+AtomDict_New( Member* member, Member* key_validator, Member* value_validator );
+
+
+int import_atomdict();
+
+
+extern PyTypeObject AtomDict_Type;
+
+
+inline int
+AtomDict_Check( PyObject* object )
+{
+    return PyObject_TypeCheck( object, &AtomDict_Type );
+}
+
+
+}  // extern C
@@ -0,0 +1,634 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cstring>
+#include "atomlist.h"
+#include "containerchange.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+static PyObject* _list_sort;
+
+
+static PyObject*
+validate_item( AtomList* self, PyObject* item )
+{
+    if( !self->validator || !self->owner )
+        return newref( item );
+    PyObject* owner = reinterpret_cast<PyObject*>( self->owner );
+    return member_validate( self->validator, owner, _py_null, item );
+}
+
+
+// Return a new list holding the validated items of the sequence.
+static PyObject*
+validate_sequence( AtomList* self, PyObject* sequence )
+{
+    PyObjectPtr items( PySequence_List( sequence ) );
+    if( !items )
+        return 0;
+    if( !self->validator || !self->owner )
+        return items.release();
+    Py_ssize_t size = PyList_GET_SIZE( items.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* item = PyList_GET_ITEM( items.get(), i );
+        PyObject* valid = validate_item( self, item );
+        if( !valid )
+            return 0;
+        if( valid != item )
+            PyList_SetItem( items.get(), i, valid );  // steals the reference
+        else
+            Py_DECREF( valid );
+    }
+    return items.release();
+}
+
+
+// Return the atom to notify of a change to the list, or null.
+static inline CAtom*
+observer_atom( AtomList* self )
+{
+    return container_observer_atom(
+        self->member, self->owner, reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+make_slice( Py_ssize_t start, Py_ssize_t stop, Py_ssize_t step=1 )
+{
+    PyObjectPtr startptr( PyInt_FromSsize_t( start ) );
+    if( !startptr )
+        return 0;
+    PyObjectPtr stopptr( PyInt_FromSsize_t( stop ) );
+    if( !stopptr )
+        return 0;
+    PyObjectPtr stepptr( step == 1 ? newref( Py_None ) : PyInt_FromSsize_t( step ) );
+    if( !stepptr )
+        return 0;
+    return PySlice_New( startptr.get(), stopptr.get(), stepptr.get() );
+}
+
+
+// Report a change to the single item at the index. The old and new
+// items may be null for an insertion or a removal.
+static int
+notify_item( AtomList* self, PyObject* kind, Py_ssize_t index, PyObject* olditem, PyObject* newitem )
+{
+    CAtom* atom = observer_atom( self );
+    if( !atom )
+        return 0;
+    PyObjectPtr key( PyInt_FromSsize_t( index ) );
+    if( !key )
+        return -1;
+    return container_notify( self->member, atom, kind, key.get(), olditem, newitem );
+}
+
+
+// Report the replacement of the old items of a slice with new items.
+// Either list may be null, which is treated the same as empty.
+static int
+notify_slice( AtomList* self, PyObject* key, PyObject* olditems, PyObject* newitems )
+{
+    bool hasold = olditems && PyList_GET_SIZE( olditems ) > 0;
+    bool hasnew = newitems && PyList_GET_SIZE( newitems ) > 0;
+    if( !hasold && !hasnew )
+        return 0;
+    CAtom* atom = observer_atom( self );
+    if( !atom )
+        return 0;
+    PyObject* kind = !hasold ? _insert_str : !hasnew ? _remove_str : _replace_str;
+    return container_notify( self->member, atom, kind, key,
+                             hasold ? olditems : 0, hasnew ? newitems : 0 );
+}
+
+
+// Report a change to the list as a whole, such as a sort.
+static int
+notify_reset( AtomList* self, PyObject* olditems )
+{
+    CAtom* atom = observer_atom( self );
+    if( !atom )
+        return 0;
+    return container_notify(
+        self->member, atom, _reset_str, 0, olditems, reinterpret_cast<PyObject*>( self ) );
+}
+
+
+// Return a copy of the list if its changes are observed, otherwise
+// return None. A copy is only made when an observer will receive it.
+static PyObject*
+observed_copy( AtomList* self )
+{
+    if( !observer_atom( self ) )
+        return newref( Py_None );
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    return PyList_GetSlice( pyself, 0, PyList_GET_SIZE( pyself ) );
+}
+
+
+PyObject*
+AtomList_New( Py_ssize_t size, Member* member, Member* validator )
+{
+    PyObjectPtr selfptr( PyType_GenericNew( &AtomList_Type, 0, 0 ) );
+    if( !selfptr )
+        return 0;
+    if( size > 0 )
+    {
+        size_t nbytes = static_cast<size_t>( size ) * sizeof( PyObject* );
+        PyObject** items = reinterpret_cast<PyObject**>( PyMem_Malloc( nbytes ) );
+        if( !items )
+            return PyErr_NoMemory();
+        memset( items, 0, nbytes );
+        PyListObject* op = reinterpret_cast<PyListObject*>( selfptr.get() );
+        op->ob_item = items;
+        Py_SIZE( op ) = size;
+        op->allocated = size;
+    }
+    AtomList* list = reinterpret_cast<AtomList*>( selfptr.get() );
+    list->member = reinterpret_cast<Member*>(
+        xnewref( reinterpret_cast<PyObject*>( member ) ) );
+    list->validator = reinterpret_cast<Member*>(
+        xnewref( reinterpret_cast<PyObject*>( validator ) ) );
+    list->owner = 0;
+    list->validated = false;
+    return selfptr.release();
+}
+
+
+static int
+AtomList_clear( AtomList* self )
+{
+    Py_CLEAR( self->member );
+    Py_CLEAR( self->validator );
+    return PyList_Type.tp_clear( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static int
+AtomList_traverse( AtomList* self, visitproc visit, void* arg )
+{
+    Py_VISIT( self->member );
+    Py_VISIT( self->validator );
+    return PyList_Type.tp_traverse( reinterpret_cast<PyObject*>( self ), visit, arg );
+}
+
+
+static void
+AtomList_dealloc( AtomList* self )
+{
+    Py_CLEAR( self->member );
+    Py_CLEAR( self->validator );
+    PyList_Type.tp_dealloc( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+AtomList_append( AtomList* self, PyObject* value )
+{
+    PyObjectPtr item( validate_item( self, value ) );
+    if( !item )
+        return 0;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    if( PyList_Append( pyself, item.get() ) < 0 )
+        return 0;
+    Py_ssize_t index = PyList_GET_SIZE( pyself ) - 1;
+    if( notify_item( self, _insert_str, index, 0, item.get() ) < 0 )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+AtomList_insert( AtomList* self, PyObject* args )
+{
+    Py_ssize_t index;
+    PyObject* value;
+    if( !PyArg_ParseTuple( args, "nO", &index, &value ) )
+        return 0;
+    PyObjectPtr item( validate_item( self, value ) );
+    if( !item )
+        return 0;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    // Clip the index the same way as list.insert.
+    Py_ssize_t size = PyList_GET_SIZE( pyself );
+    if( index < 0 )
+        index = std::max<Py_ssize_t>( index + size, 0 );
+    else if( index > size )
+        index = size;
+    if( PyList_Insert( pyself, index, item.get() ) < 0 )
+        return 0;
+    if( notify_item( self, _insert_str, index, 0, item.get() ) < 0 )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+
+// Append the validated items and report them as an insertion.
+static int
+extend_validated( AtomList* self, PyObject* items )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    Py_ssize_t start = PyList_GET_SIZE( pyself );
+    PyObjectPtr res( _PyList_Extend( reinterpret_cast<PyListObject*>( self ), items ) );
+    if( !res )
+        return -1;
+    if( PyList_GET_SIZE( items ) == 0 || !observer_atom( self ) )
+        return 0;
+    PyObjectPtr key( make_slice( start, start + PyList_GET_SIZE( items ) ) );
+    if( !key )
+        return -1;
+    return notify_slice( self, key.get(), 0, items );
+}
+
+
+static PyObject*
+AtomList_extend( AtomList* self, PyObject* value )
+{
+    PyObjectPtr items( validate_sequence( self, value ) );
+    if( !items )
+        return 0;
+    if( extend_validated( self, items.get() ) < 0 )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+AtomList_pop( AtomList* self, PyObject* args )
+{
+    Py_ssize_t index = -1;
+    if( !PyArg_ParseTuple( args, "|n:pop", &index ) )
+        return 0;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    Py_ssize_t size = PyList_GET_SIZE( pyself );
+    if( size == 0 )
+    {
+        PyErr_SetString( PyExc_IndexError, "pop from empty list" );
+        return 0;
+    }
+    if( index < 0 )
+        index += size;
+    if( index < 0 || index >= size )
+    {
+        PyErr_SetString( PyExc_IndexError, "pop index out of range" );
+        return 0;
+    }
+    PyObjectPtr item( newref( PyList_GET_ITEM( pyself, index ) ) );
+    if( PyList_SetSlice( pyself, index, index + 1, 0 ) < 0 )
+        return 0;
+    if( notify_item( self, _remove_str, index, item.get(), 0 ) < 0 )
+        return 0;
+    return item.release();
+}
+
+
+static PyObject*
+AtomList_remove( AtomList* self, PyObject* value )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    // The size is read on each pass since a comparison may run
+    // arbitrary code which modifies the list.
+    for( Py_ssize_t i = 0; i < PyList_GET_SIZE( pyself ); ++i )
+    {
+        PyObjectPtr item( newref( PyList_GET_ITEM( pyself, i ) ) );
+        int cmp = PyObject_RichCompareBool( item.get(), value, Py_EQ );
+        if( cmp < 0 )
+            return 0;
+        if( cmp == 0 )
+            continue;
+        if( PyList_SetSlice( pyself, i, i + 1, 0 ) < 0 )
+            return 0;
+        if( notify_item( self, _remove_str, i, item.get(), 0 ) < 0 )
+            return 0;
+        Py_RETURN_NONE;
+    }
+    PyErr_SetString( PyExc_ValueError, "list.remove(x): x not in list" );
+    return 0;
+}
+
+
+static PyObject*
+AtomList_sort( AtomList* self, PyObject* args, PyObject* kwargs )
+{
+    PyObjectPtr olditems( observed_copy( self ) );
+    if( !olditems )
+        return 0;
+    // Defer to list.sort, which is invoked as an unbound method.
+    PyObjectPtr sortargs( PyTuple_New( PyTuple_GET_SIZE( args ) + 1 ) );
+    if( !sortargs )
+        return 0;
+    PyTuple_SET_ITEM( sortargs.get(), 0, newref( reinterpret_cast<PyObject*>( self ) ) );
+    for( Py_ssize_t i = 0; i < PyTuple_GET_SIZE( args ); ++i )
+        PyTuple_SET_ITEM( sortargs.get(), i + 1, newref( PyTuple_GET_ITEM( args, i ) ) );
+    PyObjectPtr res( PyObject_Call( _list_sort, sortargs.get(), kwargs ) );
+    if( !res )
+        return 0;
+    if( olditems.get() != Py_None && notify_reset( self, olditems.get() ) < 0 )
+        return 0;
+    return res.release();
+}
+
+
+static PyObject*
+AtomList_reverse( AtomList* self )
+{
+    PyObjectPtr olditems( observed_copy( self ) );
+    if( !olditems )
+        return 0;
+    if( PyList_Reverse( reinterpret_cast<PyObject*>( self ) ) < 0 )
+        return 0;
+    if( olditems.get() != Py_None && notify_reset( self, olditems.get() ) < 0 )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+AtomList_reduce( AtomList* self )
+{
+    // Pickle and copy as a plain list. The owner validates the list
+    // again when the value is restored.
+    PyObjectPtr items( PySequence_List( reinterpret_cast<PyObject*>( self ) ) );
+    if( !items )
+        return 0;
+    return Py_BuildValue( "(O(O))", &PyList_Type, items.get() );
+}
+
+
+// The index has been made non-negative by the caller, but may still
+// be out of range, in which case the list raises the IndexError.
+static int
+AtomList_ass_item( AtomList* self, Py_ssize_t index, PyObject* value )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    PyObjectPtr olditem;
+    if( index >= 0 && index < PyList_GET_SIZE( pyself ) )
+        olditem = newref( PyList_GET_ITEM( pyself, index ) );
+    if( !value )
+    {
+        if( PyList_Type.tp_as_sequence->sq_ass_item( pyself, index, value ) < 0 )
+            return -1;
+        return notify_item( self, _remove_str, index, olditem.get(), 0 );
+    }
+    PyObjectPtr item( validate_item( self, value ) );
+    if( !item )
+        return -1;
+    if( PyList_Type.tp_as_sequence->sq_ass_item( pyself, index, item.get() ) < 0 )
+        return -1;
+    return notify_item( self, _replace_str, index, olditem.get(), item.get() );
+}
+
+
+static int
+AtomList_ass_slice( AtomList* self, Py_ssize_t low, Py_ssize_t high, PyObject* value )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    // Clip the bounds the same way as the list, so that the reported
+    // slice is exact.
+    Py_ssize_t size = PyList_GET_SIZE( pyself );
+    low = std::min( std::max<Py_ssize_t>( low, 0 ), size );
+    high = std::min( std::max( high, low ), size );
+    PyObjectPtr items;
+    if( value )
+    {
+        items = validate_sequence( self, value );
+        if( !items )
+            return -1;
+    }
+    PyObjectPtr olditems;
+    if( observer_atom( self ) )
+    {
+        olditems = PyList_GetSlice( pyself, low, high );
+        if( !olditems )
+            return -1;
+    }
+    if( PyList_Type.tp_as_sequence->sq_ass_slice( pyself, low, high, items.get() ) < 0 )
+        return -1;
+    if( !olditems )
+        return 0;
+    PyObjectPtr key( make_slice( low, high ) );
+    if( !key )
+        return -1;
+    return notify_slice( self, key.get(), olditems.get(), items.get() );
+}
+
+
+// Replace the items with the validated items of the sequence, which
+// is reported as a reset. The base list __init__ would bypass both.
+static int
+AtomList_init( AtomList* self, PyObject* args, PyObject* kwargs )
+{
+    PyObject* value = 0;
+    if( kwargs && PyDict_Size( kwargs ) > 0 )
+    {
+        py_type_fail( "list() takes no keyword arguments" );
+        return -1;
+    }
+    if( !PyArg_UnpackTuple( args, "list", 0, 1, &value ) )
+        return -1;
+    PyObjectPtr items( value ? validate_sequence( self, value ) : PyList_New( 0 ) );
+    if( !items )
+        return -1;
+    PyObjectPtr olditems( observed_copy( self ) );
+    if( !olditems )
+        return -1;
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    if( PyList_SetSlice( pyself, 0, PyList_GET_SIZE( pyself ), items.get() ) < 0 )
+        return -1;
+    if( olditems.get() != Py_None && notify_reset( self, olditems.get() ) < 0 )
+        return -1;
+    return 0;
+}
+
+
+static PyObject*
+AtomList_inplace_concat( AtomList* self, PyObject* value )
+{
+    PyObjectPtr items( validate_sequence( self, value ) );
+    if( !items )
+        return 0;
+    if( extend_validated( self, items.get() ) < 0 )
+        return 0;
+    return newref( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+AtomList_inplace_repeat( AtomList* self, Py_ssize_t count )
+{
+    PyObjectPtr olditems( observed_copy( self ) );
+    if( !olditems )
+        return 0;
+    PyObjectPtr res( PyList_Type.tp_as_sequence->sq_inplace_repeat(
+        reinterpret_cast<PyObject*>( self ), count ) );
+    if( !res )
+        return 0;
+    if( olditems.get() != Py_None && notify_reset( self, olditems.get() ) < 0 )
+        return 0;
+    return res.release();
+}
+
+
+static int
+AtomList_ass_subscript( AtomList* self, PyObject* key, PyObject* value )
+{
+    PyObject* pyself = reinterpret_cast<PyObject*>( self );
+    if( PyIndex_Check( key ) )
+    {
+        Py_ssize_t index = PyNumber_AsSsize_t( key, PyExc_IndexError );
+        if( index == -1 && PyErr_Occurred() )
+            return -1;
+        if( index < 0 )
+            index += PyList_GET_SIZE( pyself );
+        return AtomList_ass_item( self, index, value );
+    }
+    if( !PySlice_Check( key ) )
+        return PyList_Type.tp_as_mapping->mp_ass_subscript( pyself, key, value );
+    Py_ssize_t start, stop, step, length;
+    if( PySlice_GetIndicesEx( reinterpret_cast<PySliceObject*>( key ),
+        PyList_GET_SIZE( pyself ), &start, &stop, &step, &length ) < 0 )
+        return -1;
+    if( step == 1 )
+        return AtomList_ass_slice( self, start, stop, value );
+    // An extended slice replaces the items in place, or deletes them.
+    PyObjectPtr items;
+    if( value )
+    {
+        items = validate_sequence( self, value );
+        if( !items )
+            return -1;
+    }
+    PyObjectPtr olditems;
+    if( observer_atom( self ) )
+    {
+        olditems = PyObject_GetItem( pyself, key );
+        if( !olditems )
+            return -1;
+    }
+    if( PyList_Type.tp_as_mapping->mp_ass_subscript( pyself, key, items.get() ) < 0 )
+        return -1;
+    if( !olditems )
+        return 0;
+    PyObjectPtr slice( make_slice( start, stop, step ) );
+    if( !slice )
+        return -1;
+    return notify_slice( self, slice.get(), olditems.get(), items.get() );
+}
+
+
+static PyMethodDef
+AtomList_methods[] = {
+    { "append", ( PyCFunction )AtomList_append, METH_O,
+      "L.append(object) -- append a validated object to end" },
+    { "insert", ( PyCFunction )AtomList_insert, METH_VARARGS,
+      "L.insert(index, object) -- insert a validated object before index" },
+    { "extend", ( PyCFunction )AtomList_extend, METH_O,
+      "L.extend(iterable) -- extend list by appending validated elements from the iterable" },
+    { "pop", ( PyCFunction )AtomList_pop, METH_VARARGS,
+      "L.pop([index]) -> item -- remove and return item at index (default last)" },
+    { "remove", ( PyCFunction )AtomList_remove, METH_O,
+      "L.remove(value) -- remove first occurrence of value" },
+    { "sort", ( PyCFunction )AtomList_sort, METH_VARARGS | METH_KEYWORDS,
+      "L.sort(cmp=None, key=None, reverse=False) -- stable sort *IN PLACE*" },
+    { "reverse", ( PyCFunction )AtomList_reverse, METH_NOARGS,
+      "L.reverse() -- reverse *IN PLACE*" },
+    { "__reduce__", ( PyCFunction )AtomList_reduce, METH_NOARGS,
+      "Reduce the list to a plain list for pickling and copying." },
+    { 0 } // sentinel
+};
+
+
+PySequenceMethods AtomList_as_sequence = {
+    (lenfunc)0,                             /* sq_length */
+    (binaryfunc)0,                          /* sq_concat */
+    (ssizeargfunc)0,                        /* sq_repeat */
+    (ssizeargfunc)0,                        /* sq_item */
+    (ssizessizeargfunc)0,                   /* sq_slice */
+    (ssizeobjargproc)AtomList_ass_item,     /* sq_ass_item */
+    (ssizessizeobjargproc)AtomList_ass_slice, /* sq_ass_slice */
+    (objobjproc)0,                          /* sq_contains */
+    (binaryfunc)AtomList_inplace_concat,    /* sq_inplace_concat */
+    (ssizeargfunc)AtomList_inplace_repeat   /* sq_inplace_repeat */
+};
+
+
+PyMappingMethods AtomList_as_mapping = {
+    (lenfunc)0,                             /* mp_length */
+    (binaryfunc)0,                          /* mp_subscript */
+    (objobjargproc)AtomList_ass_subscript   /* mp_ass_subscript */
+};
+
+
+PyTypeObject AtomList_Type = {
+    PyObject_HEAD_INIT( &PyType_Type )
+    0,                                      /* ob_size */
+    "catom.AtomList",                       /* tp_name */
+    sizeof( AtomList ),                     /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    (destructor)AtomList_dealloc,           /* tp_dealloc */
+    (printfunc)0,                           /* tp_print */
+    (getattrfunc)0,                         /* tp_getattr */
+    (setattrfunc)0,                         /* tp_setattr */
+    (cmpfunc)0,                             /* tp_compare */
+    (reprfunc)0,                            /* tp_repr */
+    (PyNumberMethods*)0,                    /* tp_as_number */
+    (PySequenceMethods*)&AtomList_as_sequence, /* tp_as_sequence */
+    (PyMappingMethods*)&AtomList_as_mapping, /* tp_as_mapping */
+    (hashfunc)0,                            /* tp_hash */
+    (ternaryfunc)0,                         /* tp_call */
+    (reprfunc)0,                            /* tp_str */
+    (getattrofunc)0,                        /* tp_getattro */
+    (setattrofunc)0,                        /* tp_setattro */
+    (PyBufferProcs*)0,                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    "A list which validates the items added to it and reports its changes.", /* Documentation string */
+    (traverseproc)AtomList_traverse,        /* tp_traverse */
+    (inquiry)AtomList_clear,                /* tp_clear */
+    (richcmpfunc)0,                         /* tp_richcompare */
+    0,                                      /* tp_weaklistoffset */
+    (getiterfunc)0,                         /* tp_iter */
+    (iternextfunc)0,                        /* tp_iternext */
+    (struct PyMethodDef*)AtomList_methods,  /* tp_methods */
+    (struct PyMemberDef*)0,                 /* tp_members */
+    0,                                      /* tp_getset */
+    &PyList_Type,                           /* tp_base */
+    0,                                      /* tp_dict */
+    (descrgetfunc)0,                        /* tp_descr_get */
+    (descrsetfunc)0,                        /* tp_descr_set */
+    0,                                      /* tp_dictoffset */
+    (initproc)AtomList_init,                /* tp_init */
+    (allocfunc)0,                           /* tp_alloc */
+    (newfunc)0,                             /* tp_new */
+    (freefunc)0,                            /* tp_free */
+    (inquiry)0,                             /* tp_is_gc */
+    0,                                      /* tp_bases */
+    0,                                      /* tp_mro */
+    0,                                      /* tp_cache */
+    0,                                      /* tp_subclasses */
+    0,                                      /* tp_weaklist */
+    (destructor)0                           /* tp_del */
+};
+
+
+int
+import_atomlist()
+{
+    if( PyType_Ready( &AtomList_Type ) < 0 )
+        return -1;
+    _list_sort = PyDict_GetItemString( PyList_Type.tp_dict, "sort" );
+    if( !_list_sort )
+        return -1;
+    Py_INCREF( _list_sort );
+    return 0;
+}
+
+
+}  // extern C
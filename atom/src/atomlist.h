@@ -0,0 +1,51 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+#include "catom.h"
+#include "member.h"
+
+
+extern "C" {
+
+
+// A list subclass which validates the items added to it with the item
+// member of a List, and which reports in-place changes to the observers
+// of the List member with a ContainerChange. The owner is a borrowed
+// pointer to the atom which holds the list as the value of the member.
+// The atom sets it when the list is stored and clears it when the list
+// is released, so the list does not keep the atom alive. A list which
+// is not owned behaves as a normal list.
+typedef struct {
+    PyListObject list;
+    Member* member;
+    Member* validator;
+    CAtom* owner;
+    bool validated;  // every item was validated by the validator
+} AtomList;
+
+
+// Create a new list of the given size with null items, which must be
+// filled in with PyList_SET_ITEM. The member and validator may be null.
+// The list is not owned until it is stored, and is not marked as
+// validated, which is left to the caller.
+PyObject*
+AtomList_New( Py_ssize_t size, Member* member, Member* validator );
+
+
+int import_atomlist();
+
+
+extern PyTypeObject AtomList_Type;
+
+
+inline int
+AtomList_Check( PyObject* object )
+{
+    return PyObject_TypeCheck( object, &AtomList_Type );
+}
+
+
+}  // extern C
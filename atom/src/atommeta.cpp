@@ -0,0 +1,746 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma clang diagnostic ignored "-Wdeprecated-writable-strings"
+#pragma GCC diagnostic ignored "-Wwrite-strings"
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <vector>
+#include "catom.h"
+#include "member.h"
+#include "atommeta.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+static PyObject* _atom_members_str;
+static PyObject* _atom_layout_str;
+static PyObject* _slots_str;
+static PyObject* _name_str;
+static PyObject* _func_str;
+static PyObject* _func_name_str;
+static PyObject* _regex_str;
+static PyObject* _value_str;
+static PyObject* _match_str;
+static PyObject* _clone_str;
+static PyObject* _set_member_name_str;
+static PyObject* _set_member_index_str;
+static PyObject* _copy_static_observers_str;
+static PyObject* _set_default_kind_str;
+static PyObject* _set_validate_kind_str;
+static PyObject* _set_post_validate_kind_str;
+static PyObject* _add_static_observer_str;
+static PyObject* _resolve_static_observers_str;
+static PyObject* _re_compile;
+static PyObject* _time_time;
+static PyObject* build_hook = 0;
+
+
+}  // extern C
+
+
+// The items collected from the class dict before the class is created.
+struct ClassSpec
+{
+    std::vector<PyObjectPtr> statics;
+    std::vector<PyObjectPtr> defaults;
+    std::vector<PyObjectPtr> validates;
+    std::vector<PyObjectPtr> post_validates;
+    std::vector<PyObjectPtr> decorated;
+    std::vector<PyObjectPtr> set_defaults;
+};
+
+
+static bool
+has_prefix( PyObject* key, const char* prefix, Py_ssize_t size )
+{
+    return PyString_GET_SIZE( key ) >= size &&
+        strncmp( PyString_AS_STRING( key ), prefix, size ) == 0;
+}
+
+
+// Return the interned target name of a specially named method.
+static PyObject*
+strip_prefix( PyObject* key, Py_ssize_t size )
+{
+    PyObject* target = PyString_FromStringAndSize(
+        PyString_AS_STRING( key ) + size, PyString_GET_SIZE( key ) - size );
+    if( !target )
+        return 0;
+    PyString_InternInPlace( &target );
+    return target;
+}
+
+
+static Member*
+member_cast( PyObject* object )
+{
+    if( !Member_Check( object ) )
+    {
+        py_expected_type_fail( object, "Member" );
+        return 0;
+    }
+    return reinterpret_cast<Member*>( object );
+}
+
+
+static bool
+call_method( PyObject* object, PyObject* name, PyObject* arg1=0, PyObject* arg2=0 )
+{
+    PyObjectPtr res( PyObject_CallMethodObjArgs( object, name, arg1, arg2, 0 ) );
+    return res;
+}
+
+
+static bool
+call_method_int( PyObject* object, PyObject* name, long value, PyObject* arg2=0 )
+{
+    PyObjectPtr pyvalue( PyInt_FromLong( value ) );
+    if( !pyvalue )
+        return false;
+    return call_method( object, name, pyvalue.get(), arg2 );
+}
+
+
+// Pass over the class dict once and collect the static observers. The
+// decorated versions swap the functions back into the dict.
+static bool
+scan_class_dict( PyObject* dct, PyObject* observe, PyObject* set_default, ClassSpec& spec )
+{
+    PyObjectPtr seen( PySet_New( 0 ) );
+    if( !seen )
+        return false;
+    PyObjectPtr items( PyDict_Items( dct ) );
+    if( !items )
+        return false;
+    Py_ssize_t size = PyList_GET_SIZE( items.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* item = PyList_GET_ITEM( items.get(), i );
+        PyObject* key = PyTuple_GET_ITEM( item, 0 );
+        PyObjectPtr value( newref( PyTuple_GET_ITEM( item, 1 ) ) );
+        int res = PyObject_IsInstance( value.get(), set_default );
+        if( res < 0 )
+            return false;
+        if( res == 1 )
+        {
+            if( PyObject_SetAttr( value.get(), _name_str, key ) < 0 )
+                return false;
+            spec.set_defaults.push_back( value );
+            continue;
+        }
+        res = PyObject_IsInstance( value.get(), observe );
+        if( res < 0 )
+            return false;
+        if( res == 1 )
+        {
+            res = PySet_Contains( seen.get(), value.get() );
+            if( res < 0 )
+                return false;
+            if( res == 1 )
+            {
+                py_type_fail( "cannot bind `observe` to multiple names" );
+                return false;
+            }
+            if( PySet_Add( seen.get(), value.get() ) < 0 )
+                return false;
+            spec.decorated.push_back( value );
+            if( PyObject_SetAttr( value.get(), _func_name_str, key ) < 0 )
+                return false;
+            value = PyObject_GetAttr( value.get(), _func_str );
+            if( !value )
+                return false;
+            if( PyDict_SetItem( dct, key, value.get() ) < 0 )
+                return false;
+        }
+        if( !PyString_Check( key ) || !PyFunction_Check( value.get() ) )
+            continue;
+        PyObjectPtr keyptr( newref( key ) );
+        if( has_prefix( key, "_observe_", 9 ) )
+            spec.statics.push_back( keyptr );
+        else if( has_prefix( key, "_default_", 9 ) )
+            spec.defaults.push_back( keyptr );
+        else if( has_prefix( key, "_validate_", 10 ) )
+            spec.validates.push_back( keyptr );
+        else if( has_prefix( key, "_post_validate_", 15 ) )
+            spec.post_validates.push_back( keyptr );
+    }
+    return true;
+}
+
+
+// Walk the mro of the class, exluding itself, in reverse order
+// collecting all of the members into a single dict. The reverse
+// update preserves the mro of overridden members.
+static PyObject*
+collect_base_members( PyTypeObject* cls )
+{
+    PyObjectPtr members( PyDict_New() );
+    if( !members )
+        return 0;
+    PyObject* mro = cls->tp_mro;
+    PyObject* catom = reinterpret_cast<PyObject*>( &CAtom_Type );
+    for( Py_ssize_t i = PyTuple_GET_SIZE( mro ) - 2; i >= 1; --i )
+    {
+        PyObject* base = PyTuple_GET_ITEM( mro, i );
+        if( base == catom )
+            continue;
+        int res = PyObject_IsSubclass( base, catom );
+        if( res < 0 )
+            return 0;
+        if( res == 0 )
+            continue;
+        PyObjectPtr basemembers( PyObject_GetAttr( base, _atom_members_str ) );
+        if( !basemembers )
+            return 0;
+        if( PyDict_Update( members.get(), basemembers.get() ) < 0 )
+            return 0;
+    }
+    return members.release();
+}
+
+
+// Return a new reference to the member with the given name, cloning it
+// first if it is inherited so that the behavior of the base class is
+// not modified. Returns null without an exception if there is no such
+// member.
+static PyObject*
+owned_member( PyObject* cls, PyObject* members, PyObject* owned, PyObject* name )
+{
+    PyObject* member = PyDict_GetItem( members, name );  // borrowed
+    if( !member )
+        return 0;
+    int res = PySet_Contains( owned, member );
+    if( res < 0 )
+        return 0;
+    if( res == 1 )
+        return newref( member );
+    PyObjectPtr clone( PyObject_CallMethodObjArgs( member, _clone_str, 0 ) );
+    if( !clone )
+        return 0;
+    if( PyDict_SetItem( members, name, clone.get() ) < 0 )
+        return 0;
+    if( PySet_Add( owned, clone.get() ) < 0 )
+        return 0;
+    if( PyObject_SetAttr( cls, name, clone.get() ) < 0 )
+        return 0;
+    return clone.release();
+}
+
+
+// Apply a specially named method to the member which it targets. The
+// 'kind' is passed to the 'setter' method along with the method name,
+// or the method name is passed alone if 'kind' is negative.
+static bool
+bind_named_methods( PyObject* cls, PyObject* members, PyObject* owned,
+                    std::vector<PyObjectPtr>& names, Py_ssize_t prefix,
+                    PyObject* setter, long kind )
+{
+    std::vector<PyObjectPtr>::iterator it;
+    std::vector<PyObjectPtr>::iterator end = names.end();
+    for( it = names.begin(); it != end; ++it )
+    {
+        PyObjectPtr target( strip_prefix( it->get(), prefix ) );
+        if( !target )
+            return false;
+        PyObjectPtr member( owned_member( cls, members, owned, target.get() ) );
+        if( !member )
+        {
+            if( PyErr_Occurred() )
+                return false;
+            continue;
+        }
+        bool ok;
+        if( kind < 0 )
+            ok = call_method( member.get(), setter, it->get() );
+        else
+            ok = call_method_int( member.get(), setter, kind, it->get() );
+        if( !ok )
+            return false;
+    }
+    return true;
+}
+
+
+static bool
+bind_decorated_observer( PyObject* cls, PyObject* members, PyObject* owned, PyObject* ob )
+{
+    PyObjectPtr name( PyObject_GetAttr( ob, _name_str ) );
+    if( !name )
+        return false;
+    PyObjectPtr func_name( PyObject_GetAttr( ob, _func_name_str ) );
+    if( !func_name )
+        return false;
+    PyObjectPtr regex( PyObject_GetAttr( ob, _regex_str ) );
+    if( !regex )
+        return false;
+    int isregex = PyObject_IsTrue( regex.get() );
+    if( isregex < 0 )
+        return false;
+    if( !isregex )
+    {
+        PyObjectPtr member( owned_member( cls, members, owned, name.get() ) );
+        if( !member )
+            return !PyErr_Occurred();
+        return call_method( member.get(), _add_static_observer_str, func_name.get() );
+    }
+    PyObjectPtr rgx( PyObject_CallFunctionObjArgs( _re_compile, name.get(), 0 ) );
+    if( !rgx )
+        return false;
+    PyObjectPtr keys( PyDict_Keys( members ) );
+    if( !keys )
+        return false;
+    Py_ssize_t size = PyList_GET_SIZE( keys.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* key = PyList_GET_ITEM( keys.get(), i );
+        PyObjectPtr match( PyObject_CallMethodObjArgs( rgx.get(), _match_str, key, 0 ) );
+        if( !match )
+            return false;
+        int matched = PyObject_IsTrue( match.get() );
+        if( matched < 0 )
+            return false;
+        if( !matched )
+            continue;
+        PyObjectPtr member( owned_member( cls, members, owned, key ) );
+        if( !member )
+        {
+            if( PyErr_Occurred() )
+                return false;
+            continue;
+        }
+        if( !call_method( member.get(), _add_static_observer_str, func_name.get() ) )
+            return false;
+    }
+    return true;
+}
+
+
+static bool
+layout_fail( PyObject* cls, PyObject* item, const char* reason )
+{
+    PyObjectPtr itemstr( PyObject_Str( item ) );
+    if( !itemstr )
+        return false;
+    PyErr_Format(
+        PyExc_TypeError,
+        "Invalid __atom_layout__ for the '%s' class. '%s' %s.",
+        reinterpret_cast<PyTypeObject*>( cls )->tp_name,
+        PyString_AS_STRING( itemstr.get() ),
+        reason
+    );
+    return false;
+}
+
+
+// Move the members named by the layout hint to the lowest indices in
+// the given order, so that the values which are accessed most often
+// share the cache lines next to the object header. The other members
+// keep their relative order. An inherited member which must move is
+// cloned so that the layout of the base class is not modified.
+static bool
+apply_layout_hint( PyObject* cls, PyObject* members, PyObject* owned, PyObject* hint )
+{
+    PyObjectPtr names( PySequence_Fast( hint, "__atom_layout__ must be a sequence of member names" ) );
+    if( !names )
+        return false;
+    std::vector<std::pair<uint32_t, PyObject*> > current;  // borrowed keys
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while( PyDict_Next( members, &pos, &key, &value ) )
+    {
+        Member* member = member_cast( value );
+        if( !member )
+            return false;
+        current.push_back( std::make_pair( member->index, key ) );
+    }
+    std::sort( current.begin(), current.end() );
+
+    std::vector<PyObjectPtr> order;
+    std::set<PyObject*> placed;
+    Py_ssize_t size = PySequence_Fast_GET_SIZE( names.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* item = PySequence_Fast_GET_ITEM( names.get(), i );
+        PyObject* member = PyDict_GetItem( members, item );  // borrowed
+        if( !member )
+            return layout_fail( cls, item, "is not a member on the class" );
+        if( !placed.insert( member ).second )
+            return layout_fail( cls, item, "is listed more than once" );
+        order.push_back( PyObjectPtr( newref( item ) ) );
+    }
+    std::vector<std::pair<uint32_t, PyObject*> >::iterator cit;
+    std::vector<std::pair<uint32_t, PyObject*> >::iterator cend = current.end();
+    for( cit = current.begin(); cit != cend; ++cit )
+    {
+        if( !placed.count( PyDict_GetItem( members, cit->second ) ) )
+            order.push_back( PyObjectPtr( newref( cit->second ) ) );
+    }
+
+    uint32_t index = 0;
+    std::vector<PyObjectPtr>::iterator it;
+    std::vector<PyObjectPtr>::iterator end = order.end();
+    for( it = order.begin(); it != end; ++it, ++index )
+    {
+        Member* member = reinterpret_cast<Member*>( PyDict_GetItem( members, it->get() ) );
+        if( member->index == index )
+            continue;
+        PyObjectPtr owner( owned_member( cls, members, owned, it->get() ) );
+        if( !owner )
+            return false;
+        if( !call_method_int( owner.get(), _set_member_index_str, static_cast<long>( index ) ) )
+            return false;
+    }
+    return true;
+}
+
+
+static PyObject*
+build_class( PyObject* meta, PyObject* name, PyObject* bases, PyObject* dct,
+             PyObject* observe, PyObject* set_default )
+{
+    if( !PyType_Check( meta ) || !PyType_IsSubtype(
+        reinterpret_cast<PyTypeObject*>( meta ), &PyType_Type ) )
+        return py_expected_type_fail( meta, "type" );
+    if( !PyDict_Check( dct ) )
+        return py_expected_type_fail( dct, "dict" );
+
+    // Unless the developer requests slots, they are automatically
+    // turned off. This prevents the creation of instance dicts and
+    // other space consuming features unless explicitly requested.
+    int res = PyDict_Contains( dct, _slots_str );
+    if( res < 0 )
+        return 0;
+    if( res == 0 )
+    {
+        PyObjectPtr slots( PyTuple_New( 0 ) );
+        if( !slots || PyDict_SetItem( dct, _slots_str, slots.get() ) < 0 )
+            return 0;
+    }
+
+    ClassSpec spec;
+    if( !scan_class_dict( dct, observe, set_default, spec ) )
+        return 0;
+
+    // Remove the set_default items before creating the class.
+    std::vector<PyObjectPtr>::iterator it;
+    std::vector<PyObjectPtr>::iterator end = spec.set_defaults.end();
+    for( it = spec.set_defaults.begin(); it != end; ++it )
+    {
+        PyObjectPtr sdname( PyObject_GetAttr( it->get(), _name_str ) );
+        if( !sdname || PyDict_DelItem( dct, sdname.get() ) < 0 )
+            return 0;
+    }
+
+    // Create the class object.
+    PyObjectPtr args( PyTuple_Pack( 3, name, bases, dct ) );
+    if( !args )
+        return 0;
+    PyObjectPtr cls( PyType_Type.tp_new( reinterpret_cast<PyTypeObject*>( meta ), args.get(), 0 ) );
+    if( !cls )
+        return 0;
+    PyTypeObject* clstype = reinterpret_cast<PyTypeObject*>( cls.get() );
+
+    PyObjectPtr members( collect_base_members( clstype ) );
+    if( !members )
+        return 0;
+
+    // The set of members which belong to this class as opposed to
+    // a base class. This enables the code which sets up the static
+    // handlers to only clone when necessary.
+    PyObjectPtr owned( PySet_New( 0 ) );
+    if( !owned )
+        return 0;
+
+    // Resolve any conflicts with memory layout. Conflicts can occur
+    // with multiple inheritance where the indices of multiple base
+    // classes will overlap. When this happens, the members which
+    // conflict must be cloned in order to occupy a new index.
+    std::vector<PyObjectPtr> conflicts;
+    std::set<uint32_t> occupied;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while( PyDict_Next( members.get(), &pos, &key, &value ) )
+    {
+        Member* member = member_cast( value );
+        if( !member )
+            return 0;
+        if( occupied.count( member->index ) )
+            conflicts.push_back( PyObjectPtr( newref( value ) ) );
+        else
+            occupied.insert( member->index );
+    }
+    long resolved_index = static_cast<long>( occupied.size() );
+    end = conflicts.end();
+    for( it = conflicts.begin(); it != end; ++it )
+    {
+        PyObjectPtr clone( PyObject_CallMethodObjArgs( it->get(), _clone_str, 0 ) );
+        if( !clone )
+            return 0;
+        Member* member = member_cast( clone.get() );
+        if( !member )
+            return 0;
+        if( !call_method_int( clone.get(), _set_member_index_str, resolved_index ) )
+            return 0;
+        if( PySet_Add( owned.get(), clone.get() ) < 0 )
+            return 0;
+        PyObjectPtr clonename( newref( member->name ) );
+        if( PyDict_SetItem( members.get(), clonename.get(), clone.get() ) < 0 )
+            return 0;
+        if( PyObject_SetAttr( cls.get(), clonename.get(), clone.get() ) < 0 )
+            return 0;
+        ++resolved_index;
+    }
+
+    // Walk the set_default handlers and clone the base class member
+    // with a new member with the appropriate default. Raise an error
+    // if the set_default does not point to a member. The clone replaces
+    // the base member in the members dict, so that a later static
+    // behavior for the same name is added to it instead of to a second
+    // clone which would discard the new default.
+    end = spec.set_defaults.end();
+    for( it = spec.set_defaults.begin(); it != end; ++it )
+    {
+        PyObjectPtr sdname( PyObject_GetAttr( it->get(), _name_str ) );
+        if( !sdname )
+            return 0;
+        PyObject* base = PyDict_GetItem( members.get(), sdname.get() );  // borrowed
+        if( !base )
+        {
+            PyObjectPtr sdstr( PyObject_Str( sdname.get() ) );
+            PyObjectPtr namestr( PyObject_Str( name ) );
+            if( !sdstr || !namestr )
+                return 0;
+            PyErr_Format(
+                PyExc_TypeError,
+                "Invalid call to set_default(). '%s' is not a member "
+                "on the '%s' class.",
+                PyString_AS_STRING( sdstr.get() ),
+                PyString_AS_STRING( namestr.get() )
+            );
+            return 0;
+        }
+        PyObjectPtr member( PyObject_CallMethodObjArgs( base, _clone_str, 0 ) );
+        if( !member )
+            return 0;
+        if( PyDict_SetItem( members.get(), sdname.get(), member.get() ) < 0 )
+            return 0;
+        if( PySet_Add( owned.get(), member.get() ) < 0 )
+            return 0;
+        if( PyObject_SetAttr( cls.get(), sdname.get(), member.get() ) < 0 )
+            return 0;
+        PyObjectPtr sdvalue( PyObject_GetAttr( it->get(), _value_str ) );
+        if( !sdvalue )
+            return 0;
+        if( !call_method_int( member.get(), _set_default_kind_str, DefaultValue, sdvalue.get() ) )
+            return 0;
+    }
+
+    // Walk the dict a second time to collect the class members. This
+    // assigns the name and the index to the member. If a member is
+    // overriding an existing member, the memory index of the old
+    // member is reused and any static observers are copied over.
+    PyObjectPtr items( PyDict_Items( dct ) );
+    if( !items )
+        return 0;
+    Py_ssize_t size = PyList_GET_SIZE( items.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* item = PyList_GET_ITEM( items.get(), i );
+        key = PyTuple_GET_ITEM( item, 0 );
+        value = PyTuple_GET_ITEM( item, 1 );
+        if( !Member_Check( value ) )
+            continue;
+        res = PySet_Contains( owned.get(), value );
+        if( res < 0 )
+            return 0;
+        if( res == 1 )
+            return py_type_fail( "cannot bind member to multiple names" );
+        if( PySet_Add( owned.get(), value ) < 0 )
+            return 0;
+        if( !call_method( value, _set_member_name_str, key ) )
+            return 0;
+        PyObjectPtr supermember( xnewref( PyDict_GetItem( members.get(), key ) ) );
+        if( supermember )
+        {
+            Member* sm = member_cast( supermember.get() );
+            if( !sm )
+                return 0;
+            if( PyDict_SetItem( members.get(), key, value ) < 0 )
+                return 0;
+            if( !call_method_int( value, _set_member_index_str, static_cast<long>( sm->index ) ) )
+                return 0;
+            if( !call_method( value, _copy_static_observers_str, supermember.get() ) )
+                return 0;
+        }
+        else
+        {
+            long index = static_cast<long>( PyDict_Size( members.get() ) );
+            if( !call_method_int( value, _set_member_index_str, index ) )
+                return 0;
+            if( PyDict_SetItem( members.get(), key, value ) < 0 )
+                return 0;
+        }
+    }
+
+    // Apply the layout hint of the class, if one is given. This only
+    // renumbers the members, so it is done before the behaviors are
+    // added to avoid cloning the same member a second time.
+    PyObject* hint = PyDict_GetItem( dct, _atom_layout_str );  // borrowed
+    if( hint && !apply_layout_hint( cls.get(), members.get(), owned.get(), hint ) )
+        return 0;
+
+    // Add the special statically defined behaviors for the members.
+    // If the target member is defined on a subclass, it is cloned
+    // so that the behavior of the subclass is not modified.
+    PyObject* pycls = cls.get();
+    PyObject* pymembers = members.get();
+    PyObject* pyowned = owned.get();
+    if( !bind_named_methods( pycls, pymembers, pyowned, spec.defaults, 9,
+                             _set_default_kind_str, DefaultOwnerMethod ) )
+        return 0;
+    if( !bind_named_methods( pycls, pymembers, pyowned, spec.validates, 10,
+                             _set_validate_kind_str, ValidateOwnerMethod ) )
+        return 0;
+    if( !bind_named_methods( pycls, pymembers, pyowned, spec.post_validates, 15,
+                             _set_post_validate_kind_str, PostValidateOwnerMethod ) )
+        return 0;
+    if( !bind_named_methods( pycls, pymembers, pyowned, spec.statics, 9,
+                             _add_static_observer_str, -1 ) )
+        return 0;
+    end = spec.decorated.end();
+    for( it = spec.decorated.begin(); it != end; ++it )
+    {
+        if( !bind_decorated_observer( pycls, pymembers, pyowned, it->get() ) )
+            return 0;
+    }
+
+    // Put a reference to the members dict on the class. This is used
+    // by CAtom to query for the members and member count as needed.
+    if( PyObject_SetAttr( pycls, _atom_members_str, pymembers ) < 0 )
+        return 0;
+
+    // Resolve the static observers of the owned members to the
+    // functions on the class, so that notification can call them
+    // directly. This is done last since modifying the class after
+    // this point invalidates the resolution.
+    PyObjectPtr iter( PyObject_GetIter( pyowned ) );
+    if( !iter )
+        return 0;
+    PyObjectPtr member;
+    while( ( member = PyIter_Next( iter.get() ) ) )
+    {
+        if( !call_method( member.get(), _resolve_static_observers_str, pycls ) )
+            return 0;
+    }
+    if( PyErr_Occurred() )
+        return 0;
+
+    return cls.release();
+}
+
+
+static bool
+current_time( double& out )
+{
+    PyObjectPtr now( PyObject_CallFunctionObjArgs( _time_time, 0 ) );
+    if( !now )
+        return false;
+    out = PyFloat_AsDouble( now.get() );
+    return !( out == -1.0 && PyErr_Occurred() );
+}
+
+
+extern "C" {
+
+
+PyObject*
+atom_meta_build( PyObject* meta, PyObject* name, PyObject* bases, PyObject* dct,
+                 PyObject* observe, PyObject* set_default )
+{
+    if( !build_hook )
+        return build_class( meta, name, bases, dct, observe, set_default );
+    PyObjectPtr hook( newref( build_hook ) );
+    double start;
+    if( !current_time( start ) )
+        return 0;
+    PyObjectPtr cls( build_class( meta, name, bases, dct, observe, set_default ) );
+    if( !cls )
+        return 0;
+    double stop;
+    if( !current_time( stop ) )
+        return 0;
+    PyObjectPtr elapsed( PyFloat_FromDouble( stop - start ) );
+    if( !elapsed )
+        return 0;
+    PyObjectPtr res( PyObject_CallFunctionObjArgs( hook.get(), cls.get(), elapsed.get(), 0 ) );
+    if( !res )
+        return 0;
+    return cls.release();
+}
+
+
+void
+atom_meta_set_build_hook( PyObject* hook )
+{
+    PyObject* old = build_hook;
+    build_hook = ( hook && hook != Py_None ) ? newref( hook ) : 0;
+    Py_XDECREF( old );
+}
+
+
+static bool
+intern_string( PyObject*& out, const char* str )
+{
+    out = PyString_InternFromString( str );
+    return out != 0;
+}
+
+
+int
+import_atommeta()
+{
+    if( !intern_string( _atom_members_str, "__atom_members__" ) ||
+        !intern_string( _atom_layout_str, "__atom_layout__" ) ||
+        !intern_string( _slots_str, "__slots__" ) ||
+        !intern_string( _name_str, "name" ) ||
+        !intern_string( _func_str, "func" ) ||
+        !intern_string( _func_name_str, "func_name" ) ||
+        !intern_string( _regex_str, "regex" ) ||
+        !intern_string( _value_str, "value" ) ||
+        !intern_string( _match_str, "match" ) ||
+        !intern_string( _clone_str, "clone" ) ||
+        !intern_string( _set_member_name_str, "set_member_name" ) ||
+        !intern_string( _set_member_index_str, "set_member_index" ) ||
+        !intern_string( _copy_static_observers_str, "copy_static_observers" ) ||
+        !intern_string( _set_default_kind_str, "set_default_kind" ) ||
+        !intern_string( _set_validate_kind_str, "set_validate_kind" ) ||
+        !intern_string( _set_post_validate_kind_str, "set_post_validate_kind" ) ||
+        !intern_string( _add_static_observer_str, "add_static_observer" ) ||
+        !intern_string( _resolve_static_observers_str, "resolve_static_observers" ) )
+        return -1;
+    PyObjectPtr re( PyImport_ImportModule( "re" ) );
+    if( !re )
+        return -1;
+    _re_compile = PyObject_GetAttrString( re.get(), "compile" );
+    if( !_re_compile )
+        return -1;
+    PyObjectPtr time( PyImport_ImportModule( "time" ) );
+    if( !time )
+        return -1;
+    _time_time = PyObject_GetAttrString( time.get(), "time" );
+    if( !_time_time )
+        return -1;
+    return 0;
+}
+
+
+}  // extern C
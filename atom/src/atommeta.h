@@ -0,0 +1,33 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+
+
+extern "C" {
+
+
+// Create a new Atom class. This performs the work of AtomMeta.__new__:
+// it collects the decorated observers and the specially named methods
+// from the class dict, creates the class with type.__new__, computes
+// the member layout and wires up the static behaviors of the members.
+// 'observe' and 'set_default' are the Python decorator types. Returns
+// a new reference to the class, or null on failure.
+PyObject*
+atom_meta_build( PyObject* meta, PyObject* name, PyObject* bases, PyObject* dct,
+                 PyObject* observe, PyObject* set_default );
+
+
+// Set the callable which is invoked as hook(cls, seconds) after every
+// class built by atom_meta_build. A null or None callable removes the
+// hook. The time is only measured while a hook is installed.
+void
+atom_meta_set_build_hook( PyObject* hook );
+
+
+int import_atommeta();
+
+
+}  // extern C
@@ -4,8 +4,12 @@
 |----------------------------------------------------------------------------*/
 #pragma clang diagnostic ignored "-Wdeprecated-writable-strings"
 #pragma GCC diagnostic ignored "-Wwrite-strings"
+#include <map>
 #include "catom.h"
 #include "member.h"
+#include "filteredobserver.h"
+#include "methodwrapper.h"
+#include "containerchange.h"
 
 
 extern "C" {
@@ -15,163 +19,69 @@ static PyObject* _atom_members;
 static PyObject* _re_module;
 
 
-typedef struct {
-    PyObject_HEAD
-    PyObject* im_func;
-    PyObject* im_selfref;
-} MethodWrapper;
+typedef std::multimap<CAtom*, CAtom**> GuardMap;
 
 
-static PyObject*
-re_compile( PyObject* pystr )
-{
-    PyObjectPtr compile( PyObject_GetAttrString( _re_module, "compile" ) );
-    if( !compile )
-        return 0;
-    PyTuplePtr args( PyTuple_New( 1 ) );
-    if( !args )
-        return 0;
-    args.initialize( 0, newref( pystr ) );
-    PyObjectPtr result( compile( args ) );
-    return result.release();
-}
-
-
-static int
-MethodWrapper_Check( PyObject* obj );
+static GuardMap* guard_map = 0;
 
 
-static void
-MethodWrapper_dealloc( MethodWrapper* self )
-{
-    Py_CLEAR( self->im_selfref );
-    Py_CLEAR( self->im_func );
-    self->ob_type->tp_free( reinterpret_cast<PyObject*>( self ) );
-}
-
-
-static PyObject*
-MethodWrapper__call__( MethodWrapper* self, PyObject* args, PyObject* kwargs )
+void
+add_atom_guard( CAtom** ptr )
 {
-    PyObject* im_self = PyWeakref_GET_OBJECT( self->im_selfref );
-    if( im_self != Py_None )
-    {
-        PyObject* type = reinterpret_cast<PyObject*>( im_self->ob_type );
-        PyObjectPtr method( PyMethod_New( self->im_func, im_self, type ) );
-        if( !method )
-            return 0;
-        return PyObject_Call( method.get(), args, kwargs );
-    }
-    Py_RETURN_NONE;
+    if( !*ptr )
+        return;
+    if( !guard_map )
+        guard_map = new GuardMap();
+    guard_map->insert( GuardMap::value_type( *ptr, ptr ) );
+    ( *ptr )->count |= HAS_GUARDS_BIT;
 }
 
 
-static PyObject*
-MethodWrapper_richcompare( MethodWrapper* self, PyObject* other, int op )
+void
+remove_atom_guard( CAtom** ptr )
 {
-    if( op == Py_EQ )
+    CAtom* atom = *ptr;
+    if( !atom || !guard_map )
+        return;
+    std::pair<GuardMap::iterator, GuardMap::iterator> range = guard_map->equal_range( atom );
+    GuardMap::iterator it;
+    for( it = range.first; it != range.second; ++it )
     {
-        if( PyMethod_Check( other ) && PyMethod_GET_SELF( other ) )
+        if( it->second == ptr )
         {
-            if( ( self->im_func == PyMethod_GET_FUNCTION( other ) ) &&
-                ( PyWeakref_GET_OBJECT( self->im_selfref ) == PyMethod_GET_SELF( other ) ) )
-                Py_RETURN_TRUE;
-            Py_RETURN_FALSE;
+            guard_map->erase( it );
+            break;
         }
-        else if( MethodWrapper_Check( other ) )
-        {
-            MethodWrapper* wrapper = reinterpret_cast<MethodWrapper*>( other );
-            if( ( self->im_func == wrapper->im_func ) &&
-                ( self->im_selfref == wrapper->im_selfref ) )
-                Py_RETURN_TRUE;
-            Py_RETURN_FALSE;
-        }
-        else
-            Py_RETURN_FALSE;
     }
-    Py_RETURN_NOTIMPLEMENTED;
+    if( guard_map->find( atom ) == guard_map->end() )
+        atom->count &= ~HAS_GUARDS_BIT;
 }
 
 
-static int
-MethodWrapper__nonzero__( MethodWrapper* self )
+static void
+clear_atom_guards( CAtom* atom )
 {
-    if( PyWeakref_GET_OBJECT( self->im_selfref ) != Py_None )
-        return 1;
-    return 0;
+    std::pair<GuardMap::iterator, GuardMap::iterator> range = guard_map->equal_range( atom );
+    GuardMap::iterator it;
+    for( it = range.first; it != range.second; ++it )
+        *it->second = 0;
+    guard_map->erase( range.first, range.second );
+    atom->count &= ~HAS_GUARDS_BIT;
 }
 
 
-PyNumberMethods MethodWrapper_as_number = {
-     ( binaryfunc )0,                       /* nb_add */
-     ( binaryfunc )0,                       /* nb_subtract */
-     ( binaryfunc )0,                       /* nb_multiply */
-     ( binaryfunc )0,                       /* nb_divide */
-     ( binaryfunc )0,                       /* nb_remainder */
-     ( binaryfunc )0,                       /* nb_divmod */
-     ( ternaryfunc )0,                      /* nb_power */
-     ( unaryfunc )0,                        /* nb_negative */
-     ( unaryfunc )0,                        /* nb_positive */
-     ( unaryfunc )0,                        /* nb_absolute */
-     ( inquiry )MethodWrapper__nonzero__    /* nb_nonzero */
-};
-
-
-PyTypeObject MethodWrapper_Type = {
-    PyObject_HEAD_INIT( &PyType_Type )
-    0,                                      /* ob_size */
-    "MethodWrapper",                        /* tp_name */
-    sizeof( MethodWrapper ),                /* tp_basicsize */
-    0,                                      /* tp_itemsize */
-    (destructor)MethodWrapper_dealloc,      /* tp_dealloc */
-    (printfunc)0,                           /* tp_print */
-    (getattrfunc)0,                         /* tp_getattr */
-    (setattrfunc)0,                         /* tp_setattr */
-    (cmpfunc)0,                             /* tp_compare */
-    (reprfunc)0,                            /* tp_repr */
-    (PyNumberMethods*)&MethodWrapper_as_number, /* tp_as_number */
-    (PySequenceMethods*)0,                  /* tp_as_sequence */
-    (PyMappingMethods*)0,                   /* tp_as_mapping */
-    (hashfunc)0,                            /* tp_hash */
-    (ternaryfunc)MethodWrapper__call__,     /* tp_call */
-    (reprfunc)0,                            /* tp_str */
-    (getattrofunc)0,                        /* tp_getattro */
-    (setattrofunc)0,                        /* tp_setattro */
-    (PyBufferProcs*)0,                      /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT,                     /* tp_flags */
-    0,                                      /* Documentation string */
-    (traverseproc)0,                        /* tp_traverse */
-    (inquiry)0,                             /* tp_clear */
-    (richcmpfunc)MethodWrapper_richcompare, /* tp_richcompare */
-    0,                                      /* tp_weaklistoffset */
-    (getiterfunc)0,                         /* tp_iter */
-    (iternextfunc)0,                        /* tp_iternext */
-    (struct PyMethodDef*)0,                 /* tp_methods */
-    (struct PyMemberDef*)0,                 /* tp_members */
-    0,                                      /* tp_getset */
-    0,                                      /* tp_base */
-    0,                                      /* tp_dict */
-    (descrgetfunc)0,                        /* tp_descr_get */
-    (descrsetfunc)0,                        /* tp_descr_set */
-    0,                                      /* tp_dictoffset */
-    (initproc)0,                            /* tp_init */
-    (allocfunc)PyType_GenericAlloc,         /* tp_alloc */
-    (newfunc)0,                             /* tp_new */
-    (freefunc)PyObject_Del,                 /* tp_free */
-    (inquiry)0,                             /* tp_is_gc */
-    0,                                      /* tp_bases */
-    0,                                      /* tp_mro */
-    0,                                      /* tp_cache */
-    0,                                      /* tp_subclasses */
-    0,                                      /* tp_weaklist */
-    (destructor)0                           /* tp_del */
-};
-
-
-static int
-MethodWrapper_Check( PyObject* obj )
+static PyObject*
+re_compile( PyObject* pystr )
 {
-    return PyObject_TypeCheck( obj, &MethodWrapper_Type );
+    PyObjectPtr compile( PyObject_GetAttrString( _re_module, "compile" ) );
+    if( !compile )
+        return 0;
+    PyTuplePtr args( PyTuple_New( 1 ) );
+    if( !args )
+        return 0;
+    args.initialize( 0, newref( pystr ) );
+    PyObjectPtr result( compile( args ) );
+    return result.release();
 }
 
 
@@ -224,6 +134,7 @@ CAtom_clear( CAtom* self )
     uint32_t count = get_atom_count( self );
     for( uint32_t i = 0; i < count; ++i )
     {
+        container_released( self, 0, self->data[ i ] );
         Py_CLEAR( self->data[ i ] );
     }
 }
@@ -245,6 +156,8 @@ static void
 CAtom_dealloc( CAtom* self )
 {
     PyObject_GC_UnTrack( self );
+    if( self->count & HAS_GUARDS_BIT )
+        clear_atom_guards( self );
     CAtom_clear( self );
     if( self->data )
         PyObject_FREE( self->data );
@@ -301,22 +214,29 @@ static PyObject*
 wrap_callback( PyObject* callback )
 {
     if( PyMethod_Check( callback ) && PyMethod_GET_SELF( callback ) )
-    {
-        PyObject* wr = PyWeakref_NewRef( PyMethod_GET_SELF( callback ), 0 );
-        if( !wr )
-            return 0;
-        PyObject* pywrapper = PyType_GenericNew( &MethodWrapper_Type, 0, 0 );
-        if( !pywrapper )
-            return 0;
-        MethodWrapper* wrapper = reinterpret_cast<MethodWrapper*>( pywrapper );
-        wrapper->im_func = newref( PyMethod_GET_FUNCTION( callback ) );
-        wrapper->im_selfref = wr;
-        return pywrapper;
-    }
+        return MethodWrapper_New( callback );
     return newref( callback );
 }
 
 
+static PyObject*
+wrap_filtered_callback( PyObject* callback, PyObject* filter )
+{
+    if( filter == Py_None )
+        return wrap_callback( callback );
+    if( !PyTuple_Check( filter ) || PyTuple_GET_SIZE( filter ) != 2 )
+        return py_type_fail( "filter must be a 2-tuple of the form (kind, context)" );
+    PyObject* pykind = PyTuple_GET_ITEM( filter, 0 );
+    if( !PyInt_Check( pykind ) )
+        return py_expected_type_fail( pykind, "int" );
+    FilterKind kind = static_cast<FilterKind>( PyInt_AS_LONG( pykind ) );
+    PyObjectPtr callbackptr( wrap_callback( callback ) );
+    if( !callbackptr )
+        return 0;
+    return FilteredObserver_New( callbackptr.get(), kind, PyTuple_GET_ITEM( filter, 1 ) );
+}
+
+
 int
 observe_fast( CAtom* atom, PyObject* name, PyObject* callback )
 {
@@ -344,7 +264,7 @@ unobserve_fast( CAtom* atom, PyObject* name, PyObject* callback )
 
 
 static PyObject*
-observe_simple( CAtom* self, PyObject* name, PyObject* callback )
+observe_simple( CAtom* self, PyObject* name, PyObject* callback, PyObject* filter )
 {
     PyObject* type = reinterpret_cast<PyObject*>( self->ob_type );
     PyDictPtr members(
@@ -361,7 +281,7 @@ observe_simple( CAtom* self, PyObject* name, PyObject* callback )
         // will allow matching via pointer cmp instead of richcmp
         Member* member = reinterpret_cast<Member*>( memberptr.get() );
         PyObjectPtr topicptr( newref( member->name ) );
-        PyObjectPtr callbackptr( wrap_callback( callback ) );
+        PyObjectPtr callbackptr( wrap_filtered_callback( callback, filter ) );
         if( !callbackptr )
             return 0;
         if( !self->observers )
@@ -398,7 +318,7 @@ unobserve_simple( CAtom* self, PyObject* name, PyObject* callback )
 
 
 static PyObject*
-observe_regex( CAtom* self, PyObject* regex, PyObject* callback )
+observe_regex( CAtom* self, PyObject* regex, PyObject* callback, PyObject* filter )
 {
     PyObject* type = reinterpret_cast<PyObject*>( self->ob_type );
     PyDictPtr members(
@@ -420,7 +340,7 @@ observe_regex( CAtom* self, PyObject* regex, PyObject* callback )
     PyObject* key;
     PyObject* value;
     Py_ssize_t pos = 0;
-    PyObjectPtr callbackptr( wrap_callback( callback ) );
+    PyObjectPtr callbackptr( wrap_filtered_callback( callback, filter ) );
     if( !callbackptr )
         return 0;
     while( PyDict_Next( members.get(), &pos, &key, &value ) )
@@ -497,13 +417,14 @@ CAtom_observe( CAtom* self, PyObject* args, PyObject* kwargs )
     PyObject* name;
     PyObject* callback;
     PyObject* regex = Py_False;
-    static char* kwds[] = { "name", "callback", "regex", 0 };
+    PyObject* filter = Py_None;
+    static char* kwds[] = { "name", "callback", "regex", "filter", 0 };
     if( !PyArg_ParseTupleAndKeywords(
-        args, kwargs, "SO|O!", kwds, &name, &callback, &PyBool_Type, &regex ) )
+        args, kwargs, "SO|O!O", kwds, &name, &callback, &PyBool_Type, &regex, &filter ) )
         return 0;
     if( regex == Py_False )
-        return observe_simple( self, name, callback );
-    return observe_regex( self, name, callback );
+        return observe_simple( self, name, callback, filter );
+    return observe_regex( self, name, callback, filter );
 }
 
 
@@ -544,7 +465,7 @@ CAtom_has_observers( CAtom* self, PyObject* name )
     if( memberptr && Member_Check( memberptr.get() ) )
     {
         Member* member = reinterpret_cast<Member*>( memberptr.get() );
-        if( member->static_observers && member->static_observers->size() > 0 )
+        if( member->static_observers && member->static_observers->names.size() > 0 )
             Py_RETURN_TRUE;
     }
     if( self->observers && self->observers->has_topic( nameptr ) )
@@ -598,6 +519,58 @@ CAtom_sizeof( CAtom* self, PyObject* args )
 }
 
 
+// Lookup a plain member descriptor for the given attribute name. The
+// lookup goes through the type attribute cache, which is keyed by the
+// version tag. A member whose get or set slot is overridden, either in
+// C by a subtype or by a Python subclass, is not returned.
+static inline Member*
+lookup_plain_member( CAtom* self, PyObject* name )
+{
+    if( !PyString_CheckExact( name ) )
+        return 0;
+    PyObject* descr = _PyType_Lookup( self->ob_type, name );  // borrowed
+    if( !descr || descr->ob_type->tp_descr_get != Member_Type.tp_descr_get )
+        return 0;
+    Member* member = reinterpret_cast<Member*>( descr );
+    if( member->index >= get_atom_count( self ) )
+        return 0;
+    return member;
+}
+
+
+static PyObject*
+CAtom_getattro( CAtom* self, PyObject* name )
+{
+    Member* member = lookup_plain_member( self, name );
+    if( member )
+    {
+        PyObject* value = self->data[ member->index ];
+        if( value )
+        {
+            member_count_get( member );
+            return newref( value );
+        }
+        PyObject* pymember = reinterpret_cast<PyObject*>( member );
+        PyObject* type = reinterpret_cast<PyObject*>( self->ob_type );
+        return member->ob_type->tp_descr_get( pymember, reinterpret_cast<PyObject*>( self ), type );
+    }
+    return PyObject_GenericGetAttr( reinterpret_cast<PyObject*>( self ), name );
+}
+
+
+static int
+CAtom_setattro( CAtom* self, PyObject* name, PyObject* value )
+{
+    Member* member = lookup_plain_member( self, name );
+    if( member && member->ob_type->tp_descr_set == Member_Type.tp_descr_set )
+    {
+        member_count_set( member );
+        return member->setter( member, self, value );
+    }
+    return PyObject_GenericSetAttr( reinterpret_cast<PyObject*>( self ), name, value );
+}
+
+
 static PyMethodDef
 CAtom_methods[] = {
     { "lookup_member",
@@ -610,9 +583,10 @@ CAtom_methods[] = {
       ( PyCFunction )CAtom_set_notifications_enabled, METH_O,
       "Enable or disable notifications for the atom." },
     { "observe", ( PyCFunction )CAtom_observe, METH_VARARGS | METH_KEYWORDS,
-      "Register an observer callback to observe changes on the given member(s)." },
+      "Register an observer callback to observe changes on the given member(s), "
+      "optionally filtered by a (kind, context) filter evaluated natively." },
     { "unobserve", ( PyCFunction )CAtom_unobserve, METH_VARARGS | METH_KEYWORDS,
-      "Unregister an observer callback for the given member(s)." },
+      "Unregister an observer callback, with any filters, for the given member(s)." },
     { "has_observers", ( PyCFunction )CAtom_has_observers, METH_O,
       "Get whether the atom has observers for a given member name" },
     { "notify_observers", ( PyCFunction )CAtom_notify_observers, METH_VARARGS | METH_KEYWORDS,
@@ -623,6 +597,14 @@ CAtom_methods[] = {
 };
 
 
+// Extension types do not opt in to the type attribute cache by default.
+// The CAtom dict is never modified after the type is readied, so it is
+// safe to enable, which gives subclasses valid type version tags.
+#define CATOM_TPFLAGS \
+    ( Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC | \
+      Py_TPFLAGS_HAVE_VERSION_TAG )
+
+
 PyTypeObject CAtom_Type = {
     PyObject_HEAD_INIT( &PyType_Type )
     0,                                      /* ob_size */
@@ -641,10 +623,10 @@ PyTypeObject CAtom_Type = {
     (hashfunc)0,                            /* tp_hash */
     (ternaryfunc)0,                         /* tp_call */
     (reprfunc)0,                            /* tp_str */
-    (getattrofunc)0,                        /* tp_getattro */
-    (setattrofunc)0,                        /* tp_setattro */
+    (getattrofunc)CAtom_getattro,           /* tp_getattro */
+    (setattrofunc)CAtom_setattro,           /* tp_setattro */
     (PyBufferProcs*)0,                      /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /* tp_flags */
+    CATOM_TPFLAGS,                          /* tp_flags */
     0,                                      /* Documentation string */
     (traverseproc)CAtom_traverse,           /* tp_traverse */
     (inquiry)CAtom_clear,                   /* tp_clear */
@@ -677,8 +659,6 @@ PyTypeObject CAtom_Type = {
 int
 import_catom()
 {
-    if( PyType_Ready( &MethodWrapper_Type ) < 0 )
-        return -1;
     if( PyType_Ready( &CAtom_Type ) < 0 )
         return -1;
     _atom_members = PyString_FromString( "__atom_members__" );
@@ -18,6 +18,7 @@ using namespace PythonHelpers;
 #define MAX_MEMBER_COUNT    static_cast<uint32_t>( ( 1 << 16 ) - 1 )
 #define MEMBER_COUNT_MASK   static_cast<uint32_t>( ( 1 << 16 ) - 1 )
 #define NOTIFY_BIT          static_cast<uint32_t>( 1 << 16 )
+#define HAS_GUARDS_BIT      static_cast<uint32_t>( 1 << 17 )
 
 
 extern "C" {
@@ -55,6 +56,17 @@ get_atom_count( CAtom* atom )
 }
 
 
+// Register a pointer to an atom which is set to null when the atom is
+// destroyed. This allows a borrowed reference to an atom to be held
+// without creating a reference cycle.
+void
+add_atom_guard( CAtom** ptr );
+
+
+void
+remove_atom_guard( CAtom** ptr );
+
+
 // 'name' should be the name string on the member for best performance
 int
 observe_fast( CAtom* atom,  PyObject* name, PyObject* callback );
@@ -81,3 +93,33 @@ CAtom_Check( PyObject* object )
 
 }  // extern "C"
 
+
+// A borrowed pointer to an atom which becomes null when the atom is
+// destroyed.
+class CAtomPointer
+{
+
+public:
+
+    CAtomPointer( CAtom* atom=0 ) : m_atom( atom )
+    {
+        add_atom_guard( &m_atom );
+    }
+
+    ~CAtomPointer()
+    {
+        remove_atom_guard( &m_atom );
+    }
+
+    CAtom* data() { return m_atom; }
+
+    bool is_null() { return !m_atom; }
+
+private:
+
+    CAtom* m_atom;
+    CAtomPointer( const CAtomPointer& other );
+    CAtomPointer& operator=( const CAtomPointer& other );
+
+};
+
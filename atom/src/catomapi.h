@@ -0,0 +1,86 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <Python.h>
+
+/*-----------------------------------------------------------------------------
+| The C API exported by the catom extension module.
+|
+| Other extension modules may include this header and call
+| import_catom_capi() from their init function to gain access to the
+| API table. The table is exported as a capsule named by the macro
+| CATOM_CAPI_NAME, and is guaranteed to be compatible with a client
+| compiled against the same or an older CATOM_CAPI_VERSION.
+|----------------------------------------------------------------------------*/
+#define CATOM_CAPI_VERSION 1
+#define CATOM_CAPI_NAME "atom.catom._C_API"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* A native observer callback. It is called with the context pointer
+   given at registration along with the notification arguments. It must
+   return 0 on success, or -1 with an exception set on failure. */
+typedef int
+( *catom_observer_func )( void* context, PyObject* args, PyObject* kwargs );
+
+
+typedef struct {
+    int version;
+    PyTypeObject* CAtom_Type;
+    PyTypeObject* Member_Type;
+    PyTypeObject* MemberChange_Type;
+    /* Get the value of a member on an atom. Returns a new reference. */
+    PyObject* ( *member_get )( PyObject* member, PyObject* atom );
+    /* Set the value of a member on an atom. Returns 0 or -1. */
+    int ( *member_set )( PyObject* member, PyObject* atom, PyObject* value );
+    /* Add or remove a Python callable observer for a member name. */
+    int ( *observe )( PyObject* atom, PyObject* name, PyObject* callback );
+    int ( *unobserve )( PyObject* atom, PyObject* name, PyObject* callback );
+    /* Add or remove a native observer for a member name. The pair of
+       function and context identifies the observer. */
+    int ( *observe_native )( PyObject* atom, PyObject* name, catom_observer_func func, void* context );
+    int ( *unobserve_native )( PyObject* atom, PyObject* name, catom_observer_func func, void* context );
+} CAtom_CAPI;
+
+
+#ifndef CATOM_MODULE
+
+static CAtom_CAPI* CAtomAPI = 0;
+
+static int
+import_catom_capi( void )
+{
+    /* PyCapsule_Import only imports the top level package, so make
+       sure the extension module is loaded before the lookup. */
+    PyObject* mod = PyImport_ImportModule( "atom.catom" );
+    if( !mod )
+        return -1;
+    Py_DECREF( mod );
+    CAtomAPI = ( CAtom_CAPI* )PyCapsule_Import( CATOM_CAPI_NAME, 0 );
+    if( !CAtomAPI )
+        return -1;
+    if( CAtomAPI->version < CATOM_CAPI_VERSION )
+    {
+        PyErr_Format(
+            PyExc_ImportError,
+            "catom C API version %d is older than the required version %d",
+            CAtomAPI->version, CATOM_CAPI_VERSION
+        );
+        CAtomAPI = 0;
+        return -1;
+    }
+    return 0;
+}
+
+#endif  /* CATOM_MODULE */
+
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
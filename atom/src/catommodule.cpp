@@ -2,17 +2,252 @@
 |  Copyright (c) 2012, Enthought, Inc.
 |  All rights reserved.
 |----------------------------------------------------------------------------*/
+#pragma clang diagnostic ignored "-Wdeprecated-writable-strings"
+#pragma GCC diagnostic ignored "-Wwrite-strings"
 #include "catom.h"
 #include "member.h"
 #include "event.h"
 #include "signal.h"
+#include "notifyqueue.h"
+#include "filteredobserver.h"
+#include "nativeobserver.h"
+#include "methodwrapper.h"
+#include "atommeta.h"
+#include "atomlist.h"
+#include "atomdict.h"
+#include "containerchange.h"
 
 
 extern "C" {
 
 
+static PyObject*
+notifications_deferred( PyObject* mod )
+{
+    if( notify_queue_enabled() )
+        Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+
+static PyObject*
+set_notifications_deferred( PyObject* mod, PyObject* args, PyObject* kwargs )
+{
+    PyObject* enabled;
+    PyObject* coalesce = Py_False;
+    static char* kwds[] = { "enabled", "coalesce", 0 };
+    if( !PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O!|O!", kwds, &PyBool_Type, &enabled, &PyBool_Type, &coalesce ) )
+        return 0;
+    bool old = notify_queue_set_enabled( enabled == Py_True, coalesce == Py_True );
+    if( old )
+        Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+
+static PyObject*
+flush_notifications( PyObject* mod )
+{
+    Py_ssize_t count = notify_queue_flush();
+    if( count < 0 )
+        return 0;
+    return PyInt_FromSsize_t( count );
+}
+
+
+static PyObject*
+pending_notifications( PyObject* mod )
+{
+    return PyInt_FromSsize_t( notify_queue_size() );
+}
+
+
+static PyObject*
+set_notification_hook( PyObject* mod, PyObject* hook )
+{
+    if( hook != Py_None && !PyCallable_Check( hook ) )
+        return py_expected_type_fail( hook, "callable" );
+    notify_queue_set_hook( hook );
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+build_atom_class( PyObject* mod, PyObject* args )
+{
+    PyObject* meta;
+    PyObject* name;
+    PyObject* bases;
+    PyObject* dct;
+    PyObject* observe;
+    PyObject* set_default;
+    if( !PyArg_ParseTuple( args, "OOOO!OO", &meta, &name, &bases, &PyDict_Type, &dct,
+                           &observe, &set_default ) )
+        return 0;
+    return atom_meta_build( meta, name, bases, dct, observe, set_default );
+}
+
+
+static PyObject*
+set_class_build_hook( PyObject* mod, PyObject* hook )
+{
+    if( hook != Py_None && !PyCallable_Check( hook ) )
+        return py_expected_type_fail( hook, "callable" );
+    atom_meta_set_build_hook( hook );
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+set_access_profiling( PyObject* mod, PyObject* enabled )
+{
+    if( !PyBool_Check( enabled ) )
+        return py_expected_type_fail( enabled, "bool" );
+    bool old = member_access_profiling != 0;
+    member_access_profiling = enabled == Py_True ? 1 : 0;
+    if( old )
+        Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+
+static PyObject*
+capi_member_get( PyObject* member, PyObject* atom )
+{
+    if( !Member_Check( member ) )
+        return py_expected_type_fail( member, "Member" );
+    if( !CAtom_Check( atom ) )
+        return py_expected_type_fail( atom, "CAtom" );
+    PyObject* type = reinterpret_cast<PyObject*>( atom->ob_type );
+    return member->ob_type->tp_descr_get( member, atom, type );
+}
+
+
+static int
+capi_member_set( PyObject* member, PyObject* atom, PyObject* value )
+{
+    if( !Member_Check( member ) )
+    {
+        py_expected_type_fail( member, "Member" );
+        return -1;
+    }
+    if( !CAtom_Check( atom ) )
+    {
+        py_expected_type_fail( atom, "CAtom" );
+        return -1;
+    }
+    return member->ob_type->tp_descr_set( member, atom, value );
+}
+
+
+static int
+capi_check_atom_name( PyObject* atom, PyObject* name )
+{
+    if( !CAtom_Check( atom ) )
+    {
+        py_expected_type_fail( atom, "CAtom" );
+        return -1;
+    }
+    if( !PyString_Check( name ) )
+    {
+        py_expected_type_fail( name, "str" );
+        return -1;
+    }
+    return 0;
+}
+
+
+// Member names are interned, so interning the topic allows the
+// observer pool to match it with a pointer comparison.
+static PyObject*
+capi_intern_name( PyObject* name )
+{
+    Py_INCREF( name ); // incref before interning or segfault!!!
+    PyString_InternInPlace( &name );
+    return name;
+}
+
+
+static int
+capi_observe( PyObject* atom, PyObject* name, PyObject* callback )
+{
+    if( capi_check_atom_name( atom, name ) < 0 )
+        return -1;
+    PyObjectPtr topicptr( capi_intern_name( name ) );
+    return observe_fast( reinterpret_cast<CAtom*>( atom ), topicptr.get(), callback );
+}
+
+
+static int
+capi_unobserve( PyObject* atom, PyObject* name, PyObject* callback )
+{
+    if( capi_check_atom_name( atom, name ) < 0 )
+        return -1;
+    PyObjectPtr topicptr( capi_intern_name( name ) );
+    return unobserve_fast( reinterpret_cast<CAtom*>( atom ), topicptr.get(), callback );
+}
+
+
+static int
+capi_observe_native( PyObject* atom, PyObject* name, catom_observer_func func, void* context )
+{
+    if( capi_check_atom_name( atom, name ) < 0 )
+        return -1;
+    PyObjectPtr observer( NativeObserver_New( func, context ) );
+    if( !observer )
+        return -1;
+    PyObjectPtr topicptr( capi_intern_name( name ) );
+    return observe_fast( reinterpret_cast<CAtom*>( atom ), topicptr.get(), observer.get() );
+}
+
+
+static int
+capi_unobserve_native( PyObject* atom, PyObject* name, catom_observer_func func, void* context )
+{
+    if( capi_check_atom_name( atom, name ) < 0 )
+        return -1;
+    PyObjectPtr observer( NativeObserver_New( func, context ) );
+    if( !observer )
+        return -1;
+    PyObjectPtr topicptr( capi_intern_name( name ) );
+    return unobserve_fast( reinterpret_cast<CAtom*>( atom ), topicptr.get(), observer.get() );
+}
+
+
+static CAtom_CAPI
+catom_capi = {
+    CATOM_CAPI_VERSION,
+    &CAtom_Type,
+    &Member_Type,
+    &MemberChange_Type,
+    capi_member_get,
+    capi_member_set,
+    capi_observe,
+    capi_unobserve,
+    capi_observe_native,
+    capi_unobserve_native
+};
+
+
 static PyMethodDef
 catom_methods[] = {
+    { "notifications_deferred", ( PyCFunction )notifications_deferred, METH_NOARGS,
+      "Get whether notifications are pushed onto the deferred queue." },
+    { "set_notifications_deferred", ( PyCFunction )set_notifications_deferred, METH_VARARGS | METH_KEYWORDS,
+      "Enable or disable deferred notifications, optionally coalescing changes per atom member." },
+    { "flush_notifications", ( PyCFunction )flush_notifications, METH_NOARGS,
+      "Dispatch all deferred notifications and return the number dispatched." },
+    { "pending_notifications", ( PyCFunction )pending_notifications, METH_NOARGS,
+      "Get the number of deferred notifications waiting to be dispatched." },
+    { "set_notification_hook", ( PyCFunction )set_notification_hook, METH_O,
+      "Set a callable to invoke when the deferred queue becomes non-empty." },
+    { "build_atom_class", ( PyCFunction )build_atom_class, METH_VARARGS,
+      "Create a new Atom class and compute the layout of its members." },
+    { "set_class_build_hook", ( PyCFunction )set_class_build_hook, METH_O,
+      "Set a callable to invoke with the class and build time of each Atom class." },
+    { "set_access_profiling", ( PyCFunction )set_access_profiling, METH_O,
+      "Enable or disable counting member accesses and return the old state." },
     { 0 } // Sentinel
 };
 
@@ -25,24 +260,48 @@ initcatom( void )
         return;
     if( import_member() < 0 )
         return;
+    if( import_methodwrapper() < 0 )
+        return;
     if( import_catom() < 0 )
         return;
+    if( import_atommeta() < 0 )
+        return;
+    if( import_atomlist() < 0 )
+        return;
+    if( import_atomdict() < 0 )
+        return;
+    if( import_containerchange() < 0 )
+        return;
     if( import_event() < 0 )
         return;
     if( import_signal() < 0 )
         return;
+    if( import_filteredobserver() < 0 )
+        return;
+    if( import_nativeobserver() < 0 )
+        return;
+    PyObject* capi = PyCapsule_New( &catom_capi, CATOM_CAPI_NAME, 0 );
+    if( !capi )
+        return;
     Py_INCREF( &MemberChange_Type );
     Py_INCREF( &Member_Type );
     Py_INCREF( &CAtom_Type );
     Py_INCREF( &Event_Type );
     Py_INCREF( &Signal_Type );
+    Py_INCREF( &AtomList_Type );
+    Py_INCREF( &AtomDict_Type );
+    Py_INCREF( &ContainerChange_Type );
     Py_INCREF( _py_null );
     PyModule_AddObject( mod, "MemberChange", reinterpret_cast<PyObject*>( &MemberChange_Type ) );
     PyModule_AddObject( mod, "Member", reinterpret_cast<PyObject*>( &Member_Type ) );
     PyModule_AddObject( mod, "Event", reinterpret_cast<PyObject*>( &Event_Type ) );
     PyModule_AddObject( mod, "Signal", reinterpret_cast<PyObject*>( &Signal_Type ) );
     PyModule_AddObject( mod, "CAtom", reinterpret_cast<PyObject*>( &CAtom_Type ) );
+    PyModule_AddObject( mod, "AtomList", reinterpret_cast<PyObject*>( &AtomList_Type ) );
+    PyModule_AddObject( mod, "AtomDict", reinterpret_cast<PyObject*>( &AtomDict_Type ) );
+    PyModule_AddObject( mod, "ContainerChange", reinterpret_cast<PyObject*>( &ContainerChange_Type ) );
     PyModule_AddObject( mod, "null", _py_null );
+    PyModule_AddObject( mod, "_C_API", capi );
     PyModule_AddIntConstant( mod, "NO_VALIDATE", NoValidate );
     PyModule_AddIntConstant( mod, "VALIDATE_READ_ONLY", ValidateReadOnly );
     PyModule_AddIntConstant( mod, "VALIDATE_CONSTANT", ValidateConstant );
@@ -63,6 +322,14 @@ initcatom( void )
     PyModule_AddIntConstant( mod, "VALIDATE_ENUM", ValidateEnum );
     PyModule_AddIntConstant( mod, "VALIDATE_CALLABLE", ValidateCallable );
     PyModule_AddIntConstant( mod, "VALIDATE_RANGE", ValidateRange );
+    PyModule_AddIntConstant( mod, "VALIDATE_LONG_RANGE", ValidateLongRange );
+    PyModule_AddIntConstant( mod, "VALIDATE_FLOAT_RANGE", ValidateFloatRange );
+    PyModule_AddIntConstant( mod, "VALIDATE_COERCED", ValidateCoerced );
+    PyModule_AddIntConstant( mod, "VALIDATE_ROUND", ValidateRound );
+    PyModule_AddIntConstant( mod, "VALIDATE_STRIP", ValidateStrip );
+    PyModule_AddIntConstant( mod, "VALIDATE_PIPELINE", ValidatePipeline );
+    PyModule_AddIntConstant( mod, "VALIDATE_STR_CONSTRAINED", ValidateStrConstrained );
+    PyModule_AddIntConstant( mod, "VALIDATE_UNICODE_CONSTRAINED", ValidateUnicodeConstrained );
     PyModule_AddIntConstant( mod, "VALIDATE_OWNER_METHOD", ValidateOwnerMethod );
     PyModule_AddIntConstant( mod, "USER_VALIDATE", UserValidate );
     PyModule_AddIntConstant( mod, "NO_POST_VALIDATE", NoPostValidate );
@@ -75,6 +342,13 @@ initcatom( void )
     PyModule_AddIntConstant( mod, "DEFAULT_FACTORY", DefaultFactory );
     PyModule_AddIntConstant( mod, "DEFAULT_OWNER_METHOD", DefaultOwnerMethod );
     PyModule_AddIntConstant( mod, "USER_DEFAULT", UserDefault );
+    PyModule_AddIntConstant( mod, "FILTER_CROSSED", FilterCrossed );
+    PyModule_AddIntConstant( mod, "FILTER_DELTA", FilterDelta );
+    PyModule_AddIntConstant( mod, "FILTER_BECAME", FilterBecame );
+    PyModule_AddIntConstant( mod, "COMPARE_EQUALITY", CompareEquality );
+    PyModule_AddIntConstant( mod, "COMPARE_IDENTITY", CompareIdentity );
+    PyModule_AddIntConstant( mod, "COMPARE_NATIVE", CompareNative );
+    PyModule_AddIntConstant( mod, "COMPARE_ALWAYS", CompareAlways );
 }
 
 
@@ -0,0 +1,340 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma clang diagnostic ignored "-Wdeprecated-writable-strings"
+#pragma GCC diagnostic ignored "-Wwrite-strings"
+#include "containerchange.h"
+#include "atomlist.h"
+#include "atomdict.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+PyObject* _insert_str;
+
+
+PyObject* _remove_str;
+
+
+PyObject* _replace_str;
+
+
+PyObject* _reset_str;
+
+
+static int
+ContainerChange_clear( ContainerChange* self )
+{
+    Py_CLEAR( self->object );
+    Py_CLEAR( self->name );
+    Py_CLEAR( self->kind );
+    Py_CLEAR( self->key );
+    Py_CLEAR( self->oldvalue );
+    Py_CLEAR( self->newvalue );
+    return 0;
+}
+
+
+static int
+ContainerChange_traverse( ContainerChange* self, visitproc visit, void* arg )
+{
+    Py_VISIT( self->object );
+    Py_VISIT( self->name );
+    Py_VISIT( self->kind );
+    Py_VISIT( self->key );
+    Py_VISIT( self->oldvalue );
+    Py_VISIT( self->newvalue );
+    return 0;
+}
+
+
+static void
+ContainerChange_dealloc( ContainerChange* self )
+{
+    PyObject_GC_UnTrack( self );
+    ContainerChange_clear( self );
+    self->ob_type->tp_free( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+ContainerChange_New( PyObject* object, PyObject* name, PyObject* kind,
+                     PyObject* key, PyObject* oldvalue, PyObject* newvalue )
+{
+    PyObject* pychange = PyType_GenericNew( &ContainerChange_Type, 0, 0 );
+    if( !pychange )
+        return 0;
+    ContainerChange* change = reinterpret_cast<ContainerChange*>( pychange );
+    change->object = xnewref( object );
+    change->name = xnewref( name );
+    change->kind = xnewref( kind );
+    change->key = xnewref( key );
+    change->oldvalue = xnewref( oldvalue );
+    change->newvalue = xnewref( newvalue );
+    return pychange;
+}
+
+
+static inline PyObject*
+null_or_value( PyObject* value )
+{
+    return newref( value ? value : _py_null );
+}
+
+
+static PyObject*
+ContainerChange_get_object( ContainerChange* self, void* context )
+{
+    return null_or_value( self->object );
+}
+
+
+static PyObject*
+ContainerChange_get_name( ContainerChange* self, void* context )
+{
+    return null_or_value( self->name );
+}
+
+
+static PyObject*
+ContainerChange_get_kind( ContainerChange* self, void* context )
+{
+    return null_or_value( self->kind );
+}
+
+
+static PyObject*
+ContainerChange_get_key( ContainerChange* self, void* context )
+{
+    return null_or_value( self->key );
+}
+
+
+static PyObject*
+ContainerChange_get_oldvalue( ContainerChange* self, void* context )
+{
+    return null_or_value( self->oldvalue );
+}
+
+
+static PyObject*
+ContainerChange_get_newvalue( ContainerChange* self, void* context )
+{
+    return null_or_value( self->newvalue );
+}
+
+
+static PyGetSetDef
+ContainerChange_getset[] = {
+    { "object", ( getter )ContainerChange_get_object, 0,
+      "Get atom object whose container has changed." },
+    { "name", ( getter )ContainerChange_get_name, 0,
+      "Get the name of the member which holds the container." },
+    { "kind", ( getter )ContainerChange_get_kind, 0,
+      "Get the kind of change: 'insert', 'remove', 'replace' or 'reset'." },
+    { "key", ( getter )ContainerChange_get_key, 0,
+      "Get the index, slice or dict key which changed." },
+    { "old", ( getter )ContainerChange_get_oldvalue, 0,
+      "Get the item or items removed from the container." },
+    { "new", ( getter )ContainerChange_get_newvalue, 0,
+      "Get the item or items added to the container." },
+    { 0 } // sentinel
+};
+
+
+static PyObject*
+ContainerChange_repr( ContainerChange* self )
+{
+    PyObject* fields[] = {
+        self->object, self->name, self->kind, self->key, self->oldvalue, self->newvalue
+    };
+    PyObjectPtr reprs[ 6 ];
+    for( int i = 0; i < 6; ++i )
+    {
+        reprs[ i ] = PyObject_Repr( fields[ i ] ? fields[ i ] : _py_null );
+        if( !reprs[ i ] )
+            return 0;
+    }
+    return PyString_FromFormat(
+        "ContainerChange(object=%s, name=%s, kind=%s, key=%s, old=%s, new=%s)",
+        PyString_AsString( reprs[ 0 ].get() ),
+        PyString_AsString( reprs[ 1 ].get() ),
+        PyString_AsString( reprs[ 2 ].get() ),
+        PyString_AsString( reprs[ 3 ].get() ),
+        PyString_AsString( reprs[ 4 ].get() ),
+        PyString_AsString( reprs[ 5 ].get() )
+    );
+}
+
+
+PyTypeObject ContainerChange_Type = {
+    PyObject_HEAD_INIT( &PyType_Type )
+    0,                                      /* ob_size */
+    "catom.ContainerChange",                /* tp_name */
+    sizeof( ContainerChange ),              /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    (destructor)ContainerChange_dealloc,    /* tp_dealloc */
+    (printfunc)0,                           /* tp_print */
+    (getattrfunc)0,                         /* tp_getattr */
+    (setattrfunc)0,                         /* tp_setattr */
+    (cmpfunc)0,                             /* tp_compare */
+    (reprfunc)ContainerChange_repr,         /* tp_repr */
+    (PyNumberMethods*)0,                    /* tp_as_number */
+    (PySequenceMethods*)0,                  /* tp_as_sequence */
+    (PyMappingMethods*)0,                   /* tp_as_mapping */
+    (hashfunc)0,                            /* tp_hash */
+    (ternaryfunc)0,                         /* tp_call */
+    (reprfunc)0,                            /* tp_str */
+    (getattrofunc)0,                        /* tp_getattro */
+    (setattrofunc)0,                        /* tp_setattro */
+    (PyBufferProcs*)0,                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_GC,  /* tp_flags */
+    "A record of an in-place change to a list or dict member value.", /* Documentation string */
+    (traverseproc)ContainerChange_traverse, /* tp_traverse */
+    (inquiry)ContainerChange_clear,         /* tp_clear */
+    (richcmpfunc)0,                         /* tp_richcompare */
+    0,                                      /* tp_weaklistoffset */
+    (getiterfunc)0,                         /* tp_iter */
+    (iternextfunc)0,                        /* tp_iternext */
+    (struct PyMethodDef*)0,                 /* tp_methods */
+    (struct PyMemberDef*)0,                 /* tp_members */
+    ContainerChange_getset,                 /* tp_getset */
+    0,                                      /* tp_base */
+    0,                                      /* tp_dict */
+    (descrgetfunc)0,                        /* tp_descr_get */
+    (descrsetfunc)0,                        /* tp_descr_set */
+    0,                                      /* tp_dictoffset */
+    (initproc)0,                            /* tp_init */
+    (allocfunc)PyType_GenericAlloc,         /* tp_alloc */
+    (newfunc)0,                             /* tp_new */
+    (freefunc)PyObject_GC_Del,              /* tp_free */
+    (inquiry)0,                             /* tp_is_gc */
+    0,                                      /* tp_bases */
+    0,                                      /* tp_mro */
+    0,                                      /* tp_cache */
+    0,                                      /* tp_subclasses */
+    0,                                      /* tp_weaklist */
+    (destructor)0                           /* tp_del */
+};
+
+
+CAtom*
+container_observer_atom( Member* member, CAtom* owner, PyObject* container )
+{
+    if( !member || !owner )
+        return 0;
+    CAtom* atom = owner;
+    if( !get_atom_notify_bit( atom ) )
+        return 0;
+    // The owner is only set while the container is the value of the
+    // member, which is checked here as a safeguard.
+    if( member->index >= get_atom_count( atom ) || atom->data[ member->index ] != container )
+        return 0;
+    if( member->static_observers )
+        return atom;
+    if( !atom->observers )
+        return 0;
+    PyObjectPtr name( newref( member->name ) );
+    return atom->observers->has_topic( name ) ? atom : 0;
+}
+
+
+int
+container_notify( Member* member, CAtom* atom, PyObject* kind,
+                  PyObject* key, PyObject* oldvalue, PyObject* newvalue )
+{
+    PyObjectPtr change( ContainerChange_New(
+        reinterpret_cast<PyObject*>( atom ), member->name, kind, key, oldvalue, newvalue ) );
+    if( !change )
+        return -1;
+    PyObjectPtr args( PyTuple_New( 1 ) );
+    if( !args )
+        return -1;
+    PyTuple_SET_ITEM( args.get(), 0, change.release() );
+    PyObjectPtr kwargs( 0 );
+    return notify_observers( member, atom, args, kwargs );
+}
+
+
+// Get the owner field of an exact AtomList or AtomDict, or null for
+// any other value. Only the containers made by the validators and
+// defaults of a member are owned, and they are always exact.
+static inline CAtom**
+container_owner_field( PyObject* value, Member*& member, bool*& validated )
+{
+    if( value->ob_type == &AtomList_Type )
+    {
+        AtomList* list = reinterpret_cast<AtomList*>( value );
+        member = list->member;
+        validated = &list->validated;
+        return &list->owner;
+    }
+    if( value->ob_type == &AtomDict_Type )
+    {
+        AtomDict* dict = reinterpret_cast<AtomDict*>( value );
+        member = dict->member;
+        validated = &dict->validated;
+        return &dict->owner;
+    }
+    return 0;
+}
+
+
+void
+container_stored( CAtom* atom, Member* member, PyObject* value )
+{
+    if( !value )
+        return;
+    Member* created_by;
+    bool* validated;
+    CAtom** owner = container_owner_field( value, created_by, validated );
+    if( owner && !*owner && created_by == member )
+        *owner = atom;
+}
+
+
+void
+container_released( CAtom* atom, Member* member, PyObject* value )
+{
+    if( !value )
+        return;
+    Member* created_by;
+    bool* validated;
+    CAtom** owner = container_owner_field( value, created_by, validated );
+    if( owner && *owner == atom && ( !member || created_by == member ) )
+    {
+        // The items added while the container is not owned are not
+        // validated, so it is no longer known to be validated.
+        *owner = 0;
+        *validated = false;
+    }
+}
+
+
+int
+import_containerchange()
+{
+    if( PyType_Ready( &ContainerChange_Type ) < 0 )
+        return -1;
+    _insert_str = PyString_InternFromString( "insert" );
+    if( !_insert_str )
+        return -1;
+    _remove_str = PyString_InternFromString( "remove" );
+    if( !_remove_str )
+        return -1;
+    _replace_str = PyString_InternFromString( "replace" );
+    if( !_replace_str )
+        return -1;
+    _reset_str = PyString_InternFromString( "reset" );
+    if( !_reset_str )
+        return -1;
+    return 0;
+}
+
+
+}  // extern C
@@ -0,0 +1,76 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+#include "catom.h"
+#include "member.h"
+
+
+extern "C" {
+
+
+// A record of an in-place change to the list or dict value of a member.
+// The kind is one of the interned strings 'insert', 'remove', 'replace'
+// or 'reset'. The key is the index, slice or dict key which changed.
+typedef struct {
+    PyObject_HEAD
+    PyObject* object;
+    PyObject* name;
+    PyObject* kind;
+    PyObject* key;
+    PyObject* oldvalue;
+    PyObject* newvalue;
+} ContainerChange;
+
+
+extern PyObject* _insert_str;
+
+
+extern PyObject* _remove_str;
+
+
+extern PyObject* _replace_str;
+
+
+extern PyObject* _reset_str;
+
+
+// Get the atom to notify of a change to the container, or null if the
+// change is not observed. A change is observed when the container is
+// owned by an atom which has notifications enabled and which has a
+// static or dynamic observer for the member.
+CAtom*
+container_observer_atom( Member* member, CAtom* owner, PyObject* container );
+
+
+// Set the owner of an AtomList or AtomDict created for the member when
+// it is stored as the value of the member on the atom. Any other value
+// is ignored.
+void
+container_stored( CAtom* atom, Member* member, PyObject* value );
+
+
+// Clear the owner of an AtomList or AtomDict owned by the atom when it
+// is released from a slot of the atom, along with its validated mark.
+// A null member matches any member. Any other value is ignored.
+void
+container_released( CAtom* atom, Member* member, PyObject* value );
+
+
+// Notify the observers of the member of a change to the container. The
+// atom must have been returned by container_observer_atom. Any of the
+// key and values may be null.
+int
+container_notify( Member* member, CAtom* atom, PyObject* kind,
+                  PyObject* key, PyObject* oldvalue, PyObject* newvalue );
+
+
+int import_containerchange();
+
+
+extern PyTypeObject ContainerChange_Type;
+
+
+}  // extern C
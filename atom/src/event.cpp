@@ -84,16 +84,13 @@ EventBinder__call__( EventBinder* self, PyObject* args, PyObject* kwargs )
     if( !self->member->static_observers &&
         ( !self->atom->observers || !self->atom->observers->has_topic( nameptr ) ) )
         Py_RETURN_NONE;
-    PyObjectPtr change( MemberChange_New( owner, self->member->name, _py_null, newvalue.get() ) );
-    if( !change )
-        return 0;
-    PyTuplePtr argsptr( PyTuple_New( 1 ) );
+    PyObjectPtr argsptr( member_change_args( owner, self->member->name, _py_null, newvalue.get() ) );
     if( !argsptr )
         return 0;
-    argsptr.initialize( 0, change );
     PyObjectPtr kwargsptr( 0 );
     if( notify_observers( self->member, self->atom, argsptr, kwargsptr ) < 0 )
         return 0;
+    release_member_change_args( argsptr );
     Py_RETURN_NONE;
 }
 
@@ -208,15 +205,14 @@ Event__set__( PyObject* self, PyObject* owner, PyObject* value )
     PyObjectPtr nameptr( newref( member->name ) );
     if( !member->static_observers && ( !atom->observers || !atom->observers->has_topic( nameptr ) ) )
         return 0;
-    PyObjectPtr change( MemberChange_New( owner, member->name, _py_null, newvalue.get() ) );
-    if( !change )
-        return -1;
-    PyTuplePtr argsptr( PyTuple_New( 1 ) );
+    PyObjectPtr argsptr( member_change_args( owner, member->name, _py_null, newvalue.get() ) );
     if( !argsptr )
         return -1;
-    argsptr.initialize( 0, change );
     PyObjectPtr kwargsptr( 0 );
-    return notify_observers( member, atom, argsptr, kwargsptr );
+    if( notify_observers( member, atom, argsptr, kwargsptr ) < 0 )
+        return -1;
+    release_member_change_args( argsptr );
+    return 0;
 }
 
 
@@ -0,0 +1,272 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#include <cmath>
+#include "member.h"
+#include "filteredobserver.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+static bool
+as_double( PyObject* value, double& out )
+{
+    if( PyFloat_Check( value ) )
+    {
+        out = PyFloat_AS_DOUBLE( value );
+        return true;
+    }
+    if( PyInt_Check( value ) )
+    {
+        out = static_cast<double>( PyInt_AS_LONG( value ) );
+        return true;
+    }
+    if( PyLong_Check( value ) )
+    {
+        out = PyLong_AsDouble( value );
+        if( out == -1.0 && PyErr_Occurred() )
+        {
+            PyErr_Clear();
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+
+static int
+values_equal( PyObject* first, PyObject* second )
+{
+    if( first == second )
+        return 1;
+    return PyObject_RichCompareBool( first, second, Py_EQ );
+}
+
+
+int
+filtered_observer_accepts( FilteredObserver* self, PyObject* args, PyObject* kwargs )
+{
+    // Anything other than a single member change is passed through.
+    if( kwargs || !PyTuple_Check( args ) || PyTuple_GET_SIZE( args ) != 1 )
+        return 1;
+    PyObject* item = PyTuple_GET_ITEM( args, 0 );
+    if( !PyObject_TypeCheck( item, &MemberChange_Type ) )
+        return 1;
+    MemberChange* change = reinterpret_cast<MemberChange*>( item );
+    PyObject* oldvalue = change->oldvalue ? change->oldvalue : _py_null;
+    PyObject* newvalue = change->newvalue ? change->newvalue : _py_null;
+    switch( self->kind )
+    {
+        case FilterCrossed:
+        {
+            double oldval;
+            double newval;
+            if( !as_double( oldvalue, oldval ) || !as_double( newvalue, newval ) )
+                return 1;
+            bool wasbelow = oldval < self->threshold;
+            bool isbelow = newval < self->threshold;
+            return wasbelow != isbelow ? 1 : 0;
+        }
+        case FilterDelta:
+        {
+            double oldval;
+            double newval;
+            if( !as_double( oldvalue, oldval ) || !as_double( newvalue, newval ) )
+                return 1;
+            return std::fabs( newval - oldval ) > self->threshold ? 1 : 0;
+        }
+        case FilterBecame:
+        {
+            int became = values_equal( newvalue, self->context );
+            if( became <= 0 )
+                return became;
+            int was = values_equal( oldvalue, self->context );
+            if( was < 0 )
+                return -1;
+            return was ? 0 : 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+
+static void
+FilteredObserver_clear( FilteredObserver* self )
+{
+    Py_CLEAR( self->observer );
+    Py_CLEAR( self->context );
+}
+
+
+static int
+FilteredObserver_traverse( FilteredObserver* self, visitproc visit, void* arg )
+{
+    Py_VISIT( self->observer );
+    Py_VISIT( self->context );
+    return 0;
+}
+
+
+static void
+FilteredObserver_dealloc( FilteredObserver* self )
+{
+    PyObject_GC_UnTrack( self );
+    FilteredObserver_clear( self );
+    self->ob_type->tp_free( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+FilteredObserver__call__( FilteredObserver* self, PyObject* args, PyObject* kwargs )
+{
+    int res = filtered_observer_accepts( self, args, kwargs );
+    if( res < 0 )
+        return 0;
+    if( res == 0 )
+        Py_RETURN_NONE;
+    return PyObject_Call( self->observer, args, kwargs );
+}
+
+
+static PyObject*
+FilteredObserver_richcompare( FilteredObserver* self, PyObject* other, int op )
+{
+    if( op == Py_EQ )
+    {
+        // Filtered observers are equal when both the observer and the
+        // filter are equal. An observer with a different filter, or no
+        // filter, is a distinct observer.
+        if( !FilteredObserver_Check( other ) )
+            Py_RETURN_FALSE;
+        FilteredObserver* filtered = reinterpret_cast<FilteredObserver*>( other );
+        if( self->kind != filtered->kind )
+            Py_RETURN_FALSE;
+        int res = values_equal( self->context, filtered->context );
+        if( res < 0 )
+            return 0;
+        if( res == 0 )
+            Py_RETURN_FALSE;
+        res = values_equal( self->observer, filtered->observer );
+        if( res < 0 )
+            return 0;
+        if( res == 1 )
+            Py_RETURN_TRUE;
+        Py_RETURN_FALSE;
+    }
+    Py_RETURN_NOTIMPLEMENTED;
+}
+
+
+static int
+FilteredObserver__nonzero__( FilteredObserver* self )
+{
+    return PyObject_IsTrue( self->observer );
+}
+
+
+PyNumberMethods FilteredObserver_as_number = {
+     ( binaryfunc )0,                       /* nb_add */
+     ( binaryfunc )0,                       /* nb_subtract */
+     ( binaryfunc )0,                       /* nb_multiply */
+     ( binaryfunc )0,                       /* nb_divide */
+     ( binaryfunc )0,                       /* nb_remainder */
+     ( binaryfunc )0,                       /* nb_divmod */
+     ( ternaryfunc )0,                      /* nb_power */
+     ( unaryfunc )0,                        /* nb_negative */
+     ( unaryfunc )0,                        /* nb_positive */
+     ( unaryfunc )0,                        /* nb_absolute */
+     ( inquiry )FilteredObserver__nonzero__ /* nb_nonzero */
+};
+
+
+PyTypeObject FilteredObserver_Type = {
+    PyObject_HEAD_INIT( &PyType_Type )
+    0,                                      /* ob_size */
+    "FilteredObserver",                     /* tp_name */
+    sizeof( FilteredObserver ),             /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    (destructor)FilteredObserver_dealloc,   /* tp_dealloc */
+    (printfunc)0,                           /* tp_print */
+    (getattrfunc)0,                         /* tp_getattr */
+    (setattrfunc)0,                         /* tp_setattr */
+    (cmpfunc)0,                             /* tp_compare */
+    (reprfunc)0,                            /* tp_repr */
+    (PyNumberMethods*)&FilteredObserver_as_number, /* tp_as_number */
+    (PySequenceMethods*)0,                  /* tp_as_sequence */
+    (PyMappingMethods*)0,                   /* tp_as_mapping */
+    (hashfunc)0,                            /* tp_hash */
+    (ternaryfunc)FilteredObserver__call__,  /* tp_call */
+    (reprfunc)0,                            /* tp_str */
+    (getattrofunc)0,                        /* tp_getattro */
+    (setattrofunc)0,                        /* tp_setattro */
+    (PyBufferProcs*)0,                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_HAVE_GC,  /* tp_flags */
+    0,                                      /* Documentation string */
+    (traverseproc)FilteredObserver_traverse, /* tp_traverse */
+    (inquiry)FilteredObserver_clear,        /* tp_clear */
+    (richcmpfunc)FilteredObserver_richcompare, /* tp_richcompare */
+    0,                                      /* tp_weaklistoffset */
+    (getiterfunc)0,                         /* tp_iter */
+    (iternextfunc)0,                        /* tp_iternext */
+    (struct PyMethodDef*)0,                 /* tp_methods */
+    (struct PyMemberDef*)0,                 /* tp_members */
+    0,                                      /* tp_getset */
+    0,                                      /* tp_base */
+    0,                                      /* tp_dict */
+    (descrgetfunc)0,                        /* tp_descr_get */
+    (descrsetfunc)0,                        /* tp_descr_set */
+    0,                                      /* tp_dictoffset */
+    (initproc)0,                            /* tp_init */
+    (allocfunc)PyType_GenericAlloc,         /* tp_alloc */
+    (newfunc)0,                             /* tp_new */
+    (freefunc)PyObject_GC_Del,              /* tp_free */
+    (inquiry)0,                             /* tp_is_gc */
+    0,                                      /* tp_bases */
+    0,                                      /* tp_mro */
+    0,                                      /* tp_cache */
+    0,                                      /* tp_subclasses */
+    0,                                      /* tp_weaklist */
+    (destructor)0                           /* tp_del */
+};
+
+
+PyObject*
+FilteredObserver_New( PyObject* observer, FilterKind kind, PyObject* context )
+{
+    double threshold = 0.0;
+    if( kind <= NoFilter || kind > FilterBecame )
+        return py_value_fail( "invalid filter kind" );
+    if( kind == FilterCrossed || kind == FilterDelta )
+    {
+        if( !as_double( context, threshold ) )
+            return py_type_fail( "filter threshold must be a number" );
+    }
+    PyObject* pyfiltered = PyType_GenericAlloc( &FilteredObserver_Type, 0 );
+    if( !pyfiltered )
+        return 0;
+    FilteredObserver* filtered = reinterpret_cast<FilteredObserver*>( pyfiltered );
+    filtered->observer = newref( observer );
+    filtered->context = newref( context );
+    filtered->threshold = threshold;
+    filtered->kind = kind;
+    return pyfiltered;
+}
+
+
+int
+import_filteredobserver()
+{
+    if( PyType_Ready( &FilteredObserver_Type ) < 0 )
+        return -1;
+    return 0;
+}
+
+
+}  // extern C
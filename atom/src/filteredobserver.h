@@ -0,0 +1,55 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+
+
+extern "C" {
+
+
+enum FilterKind
+{
+    NoFilter,                   // keep this first
+    FilterCrossed,
+    FilterDelta,
+    FilterBecame                // keep this last
+};
+
+
+// An observer wrapper which only forwards a change to the wrapped
+// observer when the declarative filter accepts the change.
+typedef struct {
+    PyObject_HEAD
+    PyObject* observer;
+    PyObject* context;
+    double threshold;
+    FilterKind kind;
+} FilteredObserver;
+
+
+PyObject*
+FilteredObserver_New( PyObject* observer, FilterKind kind, PyObject* context );
+
+
+// Returns 1 if the observer should be invoked for the given arguments,
+// 0 if the change should be skipped, and -1 on error.
+int
+filtered_observer_accepts( FilteredObserver* self, PyObject* args, PyObject* kwargs );
+
+
+int import_filteredobserver();
+
+
+extern PyTypeObject FilteredObserver_Type;
+
+
+inline int
+FilteredObserver_Check( PyObject* object )
+{
+    return PyObject_TypeCheck( object, &FilteredObserver_Type );
+}
+
+
+}  // extern C
@@ -6,6 +6,8 @@
 #pragma GCC diagnostic ignored "-Wwrite-strings"
 #include "catom.h"
 #include "member.h"
+#include "notifyqueue.h"
+#include "containerchange.h"
 
 
 extern "C" {
@@ -14,6 +16,10 @@ extern "C" {
 static int numfree = 0;
 static MemberChange* freelist[ FREELIST_MAX ];
 
+#define ARGSLIST_MAX 16
+static int numargs = 0;
+static PyObject* argslist[ ARGSLIST_MAX ];  // 1-tuples holding a cleared change
+
 
 static PyObject*
 PyNull_repr( PyNull* self )
@@ -288,6 +294,297 @@ MemberChange_New( PyObject* object, PyObject* name, PyObject* oldvalue, PyObject
 }
 
 
+PyObject*
+member_change_args( PyObject* object, PyObject* name, PyObject* oldvalue, PyObject* newvalue )
+{
+    if( numargs > 0 )
+    {
+        PyObject* args = argslist[ --numargs ];
+        MemberChange* change = reinterpret_cast<MemberChange*>( PyTuple_GET_ITEM( args, 0 ) );
+        change->object = newref( object );
+        change->name = newref( name );
+        change->oldvalue = newref( oldvalue );
+        change->newvalue = newref( newvalue );
+        return args;
+    }
+    PyObjectPtr change( MemberChange_New( object, name, oldvalue, newvalue ) );
+    if( !change )
+        return 0;
+    PyTuplePtr args( PyTuple_New( 1 ) );
+    if( !args )
+        return 0;
+    args.initialize( 0, change );
+    return args.release();
+}
+
+
+void
+release_member_change_args( PyObjectPtr& args )
+{
+    PyObject* pyargs = args.release();
+    if( !pyargs )
+        return;
+    PyObject* pychange = PyTuple_GET_ITEM( pyargs, 0 );
+    if( pyargs->ob_refcnt != 1 || pychange->ob_refcnt != 1 || numargs >= ARGSLIST_MAX )
+    {
+        Py_DECREF( pyargs );
+        return;
+    }
+    // Clearing the change may run arbitrary code which takes or
+    // returns arguments, so the capacity is checked again after.
+    MemberChange_clear( reinterpret_cast<MemberChange*>( pychange ) );
+    if( numargs < ARGSLIST_MAX )
+        argslist[ numargs++ ] = pyargs;
+    else
+        Py_DECREF( pyargs );
+}
+
+
+static StaticObservers*
+share_static_observers( StaticObservers* observers )
+{
+    if( observers )
+        ++observers->refcount;
+    return observers;
+}
+
+
+static void
+release_static_observers( Member* member )
+{
+    StaticObservers* observers = member->static_observers;
+    member->static_observers = 0;
+    if( observers && --observers->refcount == 0 )
+        delete observers;
+}
+
+
+// Return the static observer names of the member for modification,
+// copying them first if the block is shared with another member.
+static StaticObservers::Names&
+own_static_observers( Member* member )
+{
+    StaticObservers* observers = member->static_observers;
+    if( !observers )
+        member->static_observers = new StaticObservers();
+    else if( observers->refcount > 1 )
+    {
+        member->static_observers = new StaticObservers();
+        member->static_observers->names = observers->names;
+        --observers->refcount;
+    }
+    return member->static_observers->names;
+}
+
+
+// The static observer functions resolved for one atom type.
+struct StaticObserverEntry
+{
+    StaticObserverEntry() : type( 0 ), version_tag( 0 ), resolved( false ) {}
+    PyTypeObject* type;         // borrowed, validated by the version tag
+    unsigned int version_tag;
+    bool resolved;
+    std::vector<PyObjectPtr> funcs;
+};
+
+
+// The static observers resolved for the atom types which most recently
+// set the member. Several entries are kept so that a base class and its
+// subclasses which share an inherited member do not evict each other.
+struct StaticObserverCache
+{
+    enum { Size = 4 };
+    StaticObserverCache() : next( 0 ) {}
+    StaticObserverEntry entries[ Size ];
+    uint32_t next;              // the entry replaced next
+
+    bool has_funcs() const
+    {
+        for( int i = 0; i < Size; ++i )
+        {
+            if( !entries[ i ].funcs.empty() )
+                return true;
+        }
+        return false;
+    }
+};
+
+
+static void
+clear_static_cache( Member* member )
+{
+    delete member->static_cache;
+    member->static_cache = 0;
+}
+
+
+// Whether the context cannot be part of a reference cycle.
+static bool
+is_atomic_context( PyObject* context )
+{
+    if( !context || context == Py_None || context == _py_null )
+        return true;
+    PyTypeObject* type = context->ob_type;
+    if( type == &PyInt_Type || type == &PyLong_Type || type == &PyFloat_Type ||
+        type == &PyBool_Type || type == &PyString_Type || type == &PyUnicode_Type )
+        return true;
+    if( type == &PyTuple_Type )
+    {
+        Py_ssize_t size = PyTuple_GET_SIZE( context );
+        for( Py_ssize_t i = 0; i < size; ++i )
+        {
+            if( !is_atomic_context( PyTuple_GET_ITEM( context, i ) ) )
+                return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+
+// Untrack the member from the garbage collector while everything it
+// traverses is atomic, i.e. cannot be part of a reference cycle, so
+// that collections skip the many members which only hold a name and
+// scalar contexts. The member is tracked again as soon as it holds a
+// container capable context, cache or static observer function, and
+// subclasses which may add storage are always tracked.
+//
+// Untracking never frees a live object, since the collector treats
+// the references held by an untracked object as external. It could
+// only leak a cycle if the member stayed untracked while holding a
+// container, so every function which stores into a traversed field
+// (the kind setters, the static observer functions and caches, and
+// clone) must call this once the new value is in place.
+static void
+member_update_gc_tracking( Member* member )
+{
+    PyObject* pymember = reinterpret_cast<PyObject*>( member );
+    bool atomic = (
+        member->ob_type->tp_basicsize == Member_Type.tp_basicsize &&
+        ( !member->static_cache || !member->static_cache->has_funcs() ) &&
+        is_atomic_context( member->default_context ) &&
+        is_atomic_context( member->validate_context ) &&
+        is_atomic_context( member->post_validate_context ) &&
+        // The enum cache only maps the items of the context to ints.
+        ( member->validate_kind == ValidateEnum || is_atomic_context( member->validate_cache ) )
+    );
+    bool tracked = _PyObject_GC_IS_TRACKED( pymember );
+    if( atomic && tracked )
+        PyObject_GC_UnTrack( pymember );
+    else if( !atomic && !tracked )
+        PyObject_GC_Track( pymember );
+}
+
+
+// Resolve the static observer names to the functions defined on the
+// given atom type. The result is valid until the type is modified,
+// which is detected via the type version tag. Returns null when the
+// names cannot be resolved ahead of time, in which case the observers
+// must be looked up on the owner.
+static StaticObserverEntry*
+static_observer_cache( Member* member, PyTypeObject* type )
+{
+    StaticObserverCache* cache = member->static_cache;
+    bool valid = PyType_HasFeature( type, Py_TPFLAGS_VALID_VERSION_TAG );
+    StaticObserverEntry* entry = 0;
+    if( cache )
+    {
+        for( int i = 0; i < StaticObserverCache::Size; ++i )
+        {
+            if( cache->entries[ i ].type == type )
+            {
+                entry = &cache->entries[ i ];
+                break;
+            }
+        }
+        if( entry && valid && entry->version_tag == type->tp_version_tag )
+            return entry->resolved ? entry : 0;
+    }
+    // An entry must not be replaced while a notification is iterating.
+    if( member->modify_guard )
+        return 0;
+    std::vector<PyObjectPtr> funcs;
+    bool resolved = false;
+    // An instance dict or a custom getattr could shadow the functions.
+    if( !type->tp_dictoffset && type->tp_getattro == CAtom_Type.tp_getattro )
+    {
+        resolved = true;
+        StaticObservers::Names::iterator it;
+        StaticObservers::Names::iterator end = member->static_observers->names.end();
+        for( it = member->static_observers->names.begin(); it != end; ++it )
+        {
+            PyObject* func = _PyType_Lookup( type, it->get() );  // borrowed
+            if( !func || !PyFunction_Check( func ) )
+            {
+                resolved = false;
+                funcs.clear();
+                break;
+            }
+            funcs.push_back( PyObjectPtr( newref( func ) ) );
+        }
+    }
+    // _PyType_Lookup assigns the version tag when the type supports it.
+    if( !PyType_HasFeature( type, Py_TPFLAGS_VALID_VERSION_TAG ) )
+        return 0;
+    if( !cache )
+        cache = member->static_cache = new StaticObserverCache();
+    // A stale entry for the type is refreshed in place, otherwise the
+    // entries are replaced in turn.
+    if( !entry )
+    {
+        entry = &cache->entries[ cache->next ];
+        cache->next = ( cache->next + 1 ) % StaticObserverCache::Size;
+    }
+    entry->type = type;
+    entry->version_tag = type->tp_version_tag;
+    entry->resolved = resolved;
+    entry->funcs.swap( funcs );
+    member_update_gc_tracking( member );
+    return resolved ? entry : 0;
+}
+
+
+static int
+call_static_observers( Member* member, PyObject* owner, PyObjectPtr& args, PyObjectPtr& kwargs )
+{
+    PyObjectPtr ownerptr( newref( owner ) );
+    StaticObserverEntry* cache = static_observer_cache( member, owner->ob_type );
+    StaticModifyGuard guard( member );
+    if( cache )
+    {
+        // Call the functions directly with the owner prepended, which
+        // avoids the attribute lookup and bound method per observer.
+        Py_ssize_t size = PyTuple_GET_SIZE( args.get() );
+        PyTuplePtr callargs( PyTuple_New( size + 1 ) );
+        if( !callargs )
+            return -1;
+        callargs.initialize( 0, ownerptr );
+        for( Py_ssize_t i = 0; i < size; ++i )
+            callargs.initialize( i + 1, newref( PyTuple_GET_ITEM( args.get(), i ) ) );
+        std::vector<PyObjectPtr>::iterator it;
+        std::vector<PyObjectPtr>::iterator end = cache->funcs.end();
+        for( it = cache->funcs.begin(); it != end; ++it )
+        {
+            PyObjectPtr func( *it );
+            if( !func( callargs, kwargs ) )
+                return -1;
+        }
+        return 0;
+    }
+    StaticObservers::Names::iterator it;
+    StaticObservers::Names::iterator end = member->static_observers->names.end();
+    for( it = member->static_observers->names.begin(); it != end; ++it )
+    {
+        PyObjectPtr method( ownerptr.get_attr( *it ) );
+        if( !method )
+            return -1;
+        if( !method( args, kwargs ) )
+            return -1;
+    }
+    return 0;
+}
+
+
 static PyObject*
 Member_new( PyTypeObject* type, PyObject* args, PyObject* kwargs )
 {
@@ -296,6 +593,8 @@ Member_new( PyTypeObject* type, PyObject* args, PyObject* kwargs )
         return 0;
     Member* member = reinterpret_cast<Member*>( selfptr.get() );
     member->name = newref( _undefined );
+    member_update_setter( member );
+    member_update_gc_tracking( member );
     return selfptr.release();
 }
 
@@ -306,8 +605,13 @@ Member_clear( Member* self )
     Py_CLEAR( self->name );
     Py_CLEAR( self->default_context );
     Py_CLEAR( self->validate_context );
-    if( self->static_observers )
-        self->static_observers->clear();
+    Py_CLEAR( self->validate_cache );
+    Py_CLEAR( self->post_validate_context );
+    if( !self->modify_guard )
+    {
+        release_static_observers( self );
+        clear_static_cache( self );
+    }
 }
 
 
@@ -317,15 +621,32 @@ Member_traverse( Member* self, visitproc visit, void* arg )
     Py_VISIT( self->name );
     Py_VISIT( self->default_context );
     Py_VISIT( self->validate_context );
-    if( self->static_observers )
+    Py_VISIT( self->validate_cache );
+    Py_VISIT( self->post_validate_context );
+    // A shared block holds a single reference to each name, which must
+    // not be reported by every member sharing it.
+    if( self->static_observers && self->static_observers->refcount == 1 )
     {
-        std::vector<PyObjectPtr>::iterator it;
-        std::vector<PyObjectPtr>::iterator end = self->static_observers->end();
-        for( it = self->static_observers->begin(); it != end; ++it )
+        StaticObservers::Names::iterator it;
+        StaticObservers::Names::iterator end = self->static_observers->names.end();
+        for( it = self->static_observers->names.begin(); it != end; ++it )
         {
             Py_VISIT( it->get() );
         }
     }
+    if( self->static_cache )
+    {
+        for( int i = 0; i < StaticObserverCache::Size; ++i )
+        {
+            std::vector<PyObjectPtr>& funcs = self->static_cache->entries[ i ].funcs;
+            std::vector<PyObjectPtr>::iterator it;
+            std::vector<PyObjectPtr>::iterator end = funcs.end();
+            for( it = funcs.begin(); it != end; ++it )
+            {
+                Py_VISIT( it->get() );
+            }
+        }
+    }
     return 0;
 }
 
@@ -335,7 +656,10 @@ Member_dealloc( Member* self )
 {
     PyObject_GC_UnTrack( self );
     Member_clear( self );
-    delete self->static_observers;
+    release_static_observers( self );
+    delete self->static_cache;
+    delete self->type_cache;
+    delete self->validate_params;
     self->ob_type->tp_free( reinterpret_cast<PyObject*>( self ) );
 }
 
@@ -370,7 +694,9 @@ Member_set_value( Member* self, PyObject* args )
     if( value == _py_null )
         value = 0;
     PyObject* old = atom->data[ self->index ];
+    container_released( atom, self, old );
     atom->data[ self->index ] = xnewref( value );
+    container_stored( atom, self, value );
     Py_XDECREF( old );
     Py_RETURN_NONE;
 }
@@ -384,17 +710,13 @@ Member_copy_static_observers( Member* self, PyObject* other )
     Member* member = reinterpret_cast<Member*>( other );
     if( self == member )
         Py_RETURN_NONE;
-    if( !member->static_observers )
-    {
-        delete self->static_observers;
-        self->static_observers = 0;
-    }
-    else
-    {
-        if( !self->static_observers )
-            self->static_observers = new std::vector<PyObjectPtr>( member->static_observers->size() );
-        *self->static_observers = *member->static_observers;
-    }
+    if( self->modify_guard )
+        return py_runtime_fail( "attempted to modify static observers during notification" );
+    clear_static_cache( self );
+    member_update_gc_tracking( self );
+    StaticObservers* observers = share_static_observers( member->static_observers );
+    release_static_observers( self );
+    self->static_observers = observers;
     Py_RETURN_NONE;
 }
 
@@ -404,7 +726,7 @@ Member_static_observers( Member* self )
 {
     if( !self->static_observers )
         return PyTuple_New( 0 );
-    std::vector<PyObjectPtr>& observers( *self->static_observers );
+    StaticObservers::Names& observers( self->static_observers->names );
     size_t size = observers.size();
     PyObject* items = PyTuple_New( size );
     if( !items )
@@ -422,17 +744,20 @@ Member_add_static_observer( Member* self, PyObject* name )
         return py_runtime_fail( "attempted to modify static observers during notification" );
     if( !PyString_Check( name ) )
         return py_expected_type_fail( name, "str" );
-    if( !self->static_observers )
-        self->static_observers = new std::vector<PyObjectPtr>();
+    clear_static_cache( self );
+    member_update_gc_tracking( self );
     PyObjectPtr nameptr( newref( name ) );
-    std::vector<PyObjectPtr>::iterator it;
-    std::vector<PyObjectPtr>::iterator end = self->static_observers->end();
-    for( it = self->static_observers->begin(); it != end; ++it )
+    if( self->static_observers )
     {
-        if( *it == nameptr || it->richcompare( nameptr, Py_EQ ) )
-            Py_RETURN_NONE;
+        StaticObservers::Names::iterator it;
+        StaticObservers::Names::iterator end = self->static_observers->names.end();
+        for( it = self->static_observers->names.begin(); it != end; ++it )
+        {
+            if( *it == nameptr || it->richcompare( nameptr, Py_EQ ) )
+                Py_RETURN_NONE;
+        }
     }
-    self->static_observers->push_back( nameptr );
+    own_static_observers( self ).push_back( nameptr );
     Py_RETURN_NONE;
 }
 
@@ -444,20 +769,23 @@ Member_remove_static_observer( Member* self, PyObject* name )
         return py_runtime_fail( "attempted to modify static observers during notification" );
     if( !PyString_Check( name ) )
         return py_expected_type_fail( name, "str" );
+    clear_static_cache( self );
+    member_update_gc_tracking( self );
     if( self->static_observers )
     {
         PyObjectPtr nameptr( newref( name ) );
-        std::vector<PyObjectPtr>::iterator it;
-        std::vector<PyObjectPtr>::iterator end = self->static_observers->end();
-        for( it = self->static_observers->begin(); it != end; ++it )
+        StaticObservers::Names& names( self->static_observers->names );
+        size_t size = names.size();
+        for( size_t i = 0; i < size; ++i )
         {
-            if( *it == nameptr || it->richcompare( nameptr, Py_EQ ) )
+            if( names[ i ] == nameptr || names[ i ].richcompare( nameptr, Py_EQ ) )
             {
-                self->static_observers->erase( it );
-                if( self->static_observers->size() == 0 )
+                if( size == 1 )
+                    release_static_observers( self );
+                else
                 {
-                    delete self->static_observers;
-                    self->static_observers = 0;
+                    StaticObservers::Names& owned( own_static_observers( self ) );
+                    owned.erase( owned.begin() + i );
                 }
                 break;
             }
@@ -537,26 +865,43 @@ Member_post_validate( Member* self, PyObject* args )
 }
 
 
+static PyObject*
+Member_resolve_static_observers( Member* self, PyObject* type )
+{
+    if( !PyType_Check( type ) )
+        return py_expected_type_fail( type, "type" );
+    if( self->static_observers )
+        static_observer_cache( self, reinterpret_cast<PyTypeObject*>( type ) );
+    Py_RETURN_NONE;
+}
+
+
 static PyObject*
 Member_clone( Member* self )
 {
     // reimplement in a subclass if more control is needed.
+    // The clone shares the contexts and the static observers of this
+    // member until one of them is changed on the clone.
     PyObject* pyclone = PyType_GenericNew( self->ob_type, 0, 0 );
     if( !pyclone )
         return 0;
     Member* clone = reinterpret_cast<Member*>( pyclone );
     clone->index = self->index;
+    clone->flags = self->flags;
     clone->name = newref( self->name );
     clone->default_kind = self->default_kind;
     clone->validate_kind = self->validate_kind;
+    clone->post_validate_kind = self->post_validate_kind;
+    clone->compare_kind = self->compare_kind;
     clone->default_context = xnewref( self->default_context );
     clone->validate_context = xnewref( self->validate_context );
-    if( self->static_observers )
-    {
-        size_t size = self->static_observers->size();
-        clone->static_observers = new std::vector<PyObjectPtr>( size );
-        *clone->static_observers = *self->static_observers;
-    }
+    clone->validate_cache = xnewref( self->validate_cache );
+    if( self->validate_params )
+        clone->validate_params = new ValidateParams( *self->validate_params );
+    clone->post_validate_context = xnewref( self->post_validate_context );
+    clone->static_observers = share_static_observers( self->static_observers );
+    member_update_setter( clone );
+    member_update_gc_tracking( clone );
     return pyclone;
 }
 
@@ -572,6 +917,7 @@ Member__get__( PyObject* self, PyObject* owner, PyObject* type )
     Member* member = reinterpret_cast<Member*>( self );
     if( member->index >= get_atom_count( atom ) )
         return py_no_attr_fail( owner, PyString_AsString( member->name ) );
+    member_count_get( member );
     PyObjectPtr value( atom->data[ member->index ] );  // borrow ref
     if( value )
         return value.incref_release();                 // take owned ref
@@ -585,28 +931,74 @@ Member__get__( PyObject* self, PyObject* owner, PyObject* type )
         if( !value )
             return 0;
         if( value != _py_null )
+        {
             atom->data[ member->index ] = value.newref();  // take owned internal ref
+            container_stored( atom, member, value.get() );
+        }
         return value.release();                            // return owned ref to caller
     }
     return newref( _py_null );
 }
 
 
+// Compare exact builtin scalars without going through the rich
+// comparison protocol. Returns 1 if equal, 0 if not equal, and -1 if
+// the values cannot be compared natively.
 static int
-Member__set__( PyObject* self, PyObject* owner, PyObject* value )
+native_values_equal( PyObject* first, PyObject* second )
 {
-    if( !CAtom_Check( owner ) )
-    {
-        py_expected_type_fail( owner, "CAtom" );
+    if( first->ob_type != second->ob_type )
         return -1;
+    if( PyInt_CheckExact( first ) )
+        return PyInt_AS_LONG( first ) == PyInt_AS_LONG( second ) ? 1 : 0;
+    if( PyFloat_CheckExact( first ) )
+        return PyFloat_AS_DOUBLE( first ) == PyFloat_AS_DOUBLE( second ) ? 1 : 0;
+    if( PyString_CheckExact( first ) )
+        return _PyString_Eq( first, second ) ? 1 : 0;
+    if( PyUnicode_CheckExact( first ) )
+    {
+        Py_ssize_t size = PyUnicode_GET_SIZE( first );
+        if( size != PyUnicode_GET_SIZE( second ) )
+            return 0;
+        size_t nbytes = static_cast<size_t>( size ) * sizeof( Py_UNICODE );
+        return memcmp( PyUnicode_AS_UNICODE( first ), PyUnicode_AS_UNICODE( second ), nbytes ) == 0 ? 1 : 0;
     }
-    CAtom* atom = reinterpret_cast<CAtom*>( owner );
-    Member* member = reinterpret_cast<Member*>( self );
-    if( member->index >= get_atom_count( atom ) )
+    if( PyBool_Check( first ) || first == _py_null )
+        return 0;  // singletons, and the values are known to differ
+    return -1;
+}
+
+
+// Whether the change from the old value to the new value should be
+// suppressed according to the compare kind of the member.
+bool
+member_values_equal( Member* member, PyObjectPtr& oldptr, PyObjectPtr& newptr )
+{
+    switch( member->compare_kind )
     {
-        py_no_attr_fail( owner, PyString_AsString( member->name ) );
-        return -1;
+        case CompareIdentity:
+            return oldptr == newptr;
+        case CompareNative:
+        {
+            if( oldptr == newptr )
+                return true;
+            int res = native_values_equal( oldptr.get(), newptr.get() );
+            if( res >= 0 )
+                return res == 1;
+            return oldptr.richcompare( newptr, Py_EQ );
+        }
+        case CompareAlways:
+            return false;
+        default:
+            return oldptr == newptr || oldptr.richcompare( newptr, Py_EQ );
     }
+}
+
+
+int
+member_set_generic( Member* member, CAtom* atom, PyObject* value )
+{
+    PyObject* owner = reinterpret_cast<PyObject*>( atom );
     PyObjectPtr oldptr( atom->data[ member->index ] );    // borrow ref
     PyObjectPtr newptr( value != _py_null ? value : 0 );  // borrow ref
     if( oldptr == newptr )
@@ -635,70 +1027,120 @@ Member__set__( PyObject* self, PyObject* owner, PyObject* value )
         if( newptr == _py_null )
             newptr.decref_release();
     }
+    container_released( atom, member, atom->data[ member->index ] );
     Py_XDECREF( atom->data[ member->index] );        // release internally owned ref
     atom->data[ member->index ] = newptr.xnewref();  // take internally owned ref
-    if( get_atom_notify_bit( atom ) )
+    container_stored( atom, member, newptr.get() );
+    return member_notify_change( member, atom, oldptr, newptr );
+}
+
+
+void
+member_set_validate_cache( Member* member, PyObject* cache )
+{
+    PyObject* old = member->validate_cache;
+    member->validate_cache = xnewref( cache );
+    Py_XDECREF( old );
+    member_update_gc_tracking( member );
+}
+
+
+void
+member_clear_type_cache( Member* member )
+{
+    delete member->type_cache;
+    member->type_cache = 0;
+}
+
+
+int
+member_notify_change( Member* member, CAtom* atom, PyObjectPtr& oldptr, PyObjectPtr& newptr )
+{
+    if( !get_atom_notify_bit( atom ) )
+        return 0;
+    PyObject* owner = reinterpret_cast<PyObject*>( atom );
+    if( notify_queue_enabled() )
+    {
+        PyObjectPtr nameptr( newref( member->name ) );
+        if( !member->static_observers &&
+            ( !atom->observers || !atom->observers->has_topic( nameptr ) ) )
+            return 0;
+        if( !oldptr )
+            oldptr.set( newref( _py_null ) );
+        if( !newptr )
+            newptr.set( newref( _py_null ) );
+        if( member_values_equal( member, oldptr, newptr ) )
+            return 0;
+        PyObjectPtr argsptr( member_change_args( owner, member->name, oldptr.get(), newptr.get() ) );
+        if( !argsptr )
+            return -1;
+        PyObjectPtr kwargsptr( 0 );
+        return notify_queue_push( member, atom, argsptr, kwargsptr );
+    }
+    // The static and dynamic observers share the same arguments,
+    // which are recycled once all observers have returned.
+    PyObjectPtr argsptr;
+    PyObjectPtr kwargsptr( 0 );
+    if( member->static_observers )
     {
-        PyObjectPtr changeptr;
-        if( member->static_observers )
+        if( !oldptr )
+            oldptr.set( newref( _py_null ) );
+        if( !newptr )
+            newptr.set( newref( _py_null ) );
+        if( member_values_equal( member, oldptr, newptr ) )
+            return 0;
+        argsptr.set( member_change_args( owner, member->name, oldptr.get(), newptr.get() ) );
+        if( !argsptr )
+            return -1;
+        if( call_static_observers( member, owner, argsptr, kwargsptr ) < 0 )
+            return -1;
+    }
+    if( atom->observers )
+    {
+        PyObjectPtr nameptr( newref( member->name ) );
+        if( atom->observers->has_topic( nameptr ) )
         {
-            if( !oldptr )
-                oldptr.set( newref( _py_null ) );
-            if( !newptr )
-                newptr.set( newref( _py_null ) );
-            if( oldptr == newptr || oldptr.richcompare( newptr, Py_EQ ) )
-                return 0;
-            changeptr.set( MemberChange_New( owner, member->name, oldptr.get(), newptr.get() ) );
-            if( !changeptr )
-                return -1;
-            PyTuplePtr argsptr( PyTuple_New( 1 ) );
             if( !argsptr )
-                return -1;
-            argsptr.initialize( 0, changeptr );
-            PyObjectPtr ownerptr( newref( owner ) );
-            StaticModifyGuard guard( member );
-            std::vector<PyObjectPtr>::iterator it;
-            std::vector<PyObjectPtr>::iterator end = member->static_observers->end();
-            for( it = member->static_observers->begin(); it != end; ++it )
-            {
-                PyObjectPtr method( ownerptr.get_attr( *it ) );
-                if( !method )
-                    return -1;
-                if( !method( argsptr ) )
-                    return -1;
-            }
-        }
-        if( atom->observers )
-        {
-            PyObjectPtr nameptr( newref( member->name ) );
-            if( atom->observers->has_topic( nameptr ) )
             {
-                if( !changeptr )
-                {
-                    if( !oldptr )
-                        oldptr.set( newref( _py_null ) );
-                    if( !newptr )
-                        newptr.set( newref( _py_null ) );
-                    if( oldptr == newptr || oldptr.richcompare( newptr, Py_EQ ) )
-                        return 0;
-                    changeptr.set( MemberChange_New( owner, member->name, oldptr.get(), newptr.get() ) );
-                    if( !changeptr )
-                        return -1;
-                }
-                PyTuplePtr argsptr( PyTuple_New( 1 ) );
+                if( !oldptr )
+                    oldptr.set( newref( _py_null ) );
+                if( !newptr )
+                    newptr.set( newref( _py_null ) );
+                if( member_values_equal( member, oldptr, newptr ) )
+                    return 0;
+                argsptr.set( member_change_args( owner, member->name, oldptr.get(), newptr.get() ) );
                 if( !argsptr )
                     return -1;
-                argsptr.initialize( 0, changeptr );
-                PyObjectPtr kwargsptr( 0 );
-                if( atom->observers->notify( nameptr, argsptr, kwargsptr ) < 0 )
-                    return -1;
             }
+            if( atom->observers->notify( nameptr, argsptr, kwargsptr ) < 0 )
+                return -1;
         }
     }
+    release_member_change_args( argsptr );
     return 0;
 }
 
 
+static int
+Member__set__( PyObject* self, PyObject* owner, PyObject* value )
+{
+    if( !CAtom_Check( owner ) )
+    {
+        py_expected_type_fail( owner, "CAtom" );
+        return -1;
+    }
+    CAtom* atom = reinterpret_cast<CAtom*>( owner );
+    Member* member = reinterpret_cast<Member*>( self );
+    if( member->index >= get_atom_count( atom ) )
+    {
+        py_no_attr_fail( owner, PyString_AsString( member->name ) );
+        return -1;
+    }
+    member_count_set( member );
+    return member->setter( member, atom, value );
+}
+
+
 static PyObject*
 Member_get_name( Member* self, void* context )
 {
@@ -763,13 +1205,13 @@ Member_get_default_kind( Member* self, void* ctxt )
 static PyObject*
 Member_set_default_kind( Member* self, PyObject* args )
 {
-    DefaultKind kind;
+    long kind;
     PyObject* context;
     if( !PyArg_ParseTuple( args, "lO", &kind, &context ) )
         return 0;
     if( kind < NoDefault || kind > UserDefault )
         return py_value_fail( "invalid default kind" );
-    self->default_kind = kind;
+    self->default_kind = static_cast<uint8_t>( kind );
     if( kind == NoDefault )
     {
         Py_XDECREF( self->default_context );
@@ -781,6 +1223,7 @@ Member_set_default_kind( Member* self, PyObject* args )
         Py_XDECREF( self->default_context );
         self->default_context = context;
     }
+    member_update_gc_tracking( self );
     Py_RETURN_NONE;
 }
 
@@ -802,13 +1245,21 @@ Member_get_validate_kind( Member* self, void* ctxt )
 static PyObject*
 Member_set_validate_kind( Member* self, PyObject* args )
 {
-    ValidateKind kind;
+    long kind;
     PyObject* context;
     if( !PyArg_ParseTuple( args, "lO", &kind, &context ) )
         return 0;
     if( kind < NoValidate || kind > UserValidate )
         return py_value_fail( "invalid validate kind" );
-    self->validate_kind = kind;
+    ValidateParams* params;
+    if( member_parse_validate_params( static_cast<uint8_t>( kind ), context, params ) < 0 )
+        return 0;
+    delete self->validate_params;
+    self->validate_params = params;
+    self->validate_kind = static_cast<uint8_t>( kind );
+    member_update_setter( self );
+    Py_CLEAR( self->validate_cache );
+    member_clear_type_cache( self );
     if( kind == NoValidate )
     {
         Py_XDECREF( self->validate_context );
@@ -820,6 +1271,7 @@ Member_set_validate_kind( Member* self, PyObject* args )
         Py_XDECREF( self->validate_context );
         self->validate_context = context;
     }
+    member_update_gc_tracking( self );
     Py_RETURN_NONE;
 }
 
@@ -841,13 +1293,14 @@ Member_get_post_validate_kind( Member* self, void* ctxt )
 static PyObject*
 Member_set_post_validate_kind( Member* self, PyObject* args )
 {
-    PostValidateKind kind;
+    long kind;
     PyObject* context;
     if( !PyArg_ParseTuple( args, "lO", &kind, &context ) )
         return 0;
     if( kind < NoPostValidate || kind > UserPostValidate )
         return py_value_fail( "invalid post validate kind" );
-    self->post_validate_kind = kind;
+    self->post_validate_kind = static_cast<uint8_t>( kind );
+    member_update_setter( self );
     if( kind == NoPostValidate )
     {
         Py_XDECREF( self->post_validate_context );
@@ -859,6 +1312,44 @@ Member_set_post_validate_kind( Member* self, PyObject* args )
         Py_XDECREF( self->post_validate_context );
         self->post_validate_context = context;
     }
+    member_update_gc_tracking( self );
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+Member_get_compare_kind( Member* self, void* ctxt )
+{
+    return PyInt_FromLong( self->compare_kind );
+}
+
+
+static PyObject*
+Member_set_compare_kind( Member* self, PyObject* arg )
+{
+    if( !PyInt_Check( arg ) )
+        return py_expected_type_fail( arg, "int" );
+    long kind = PyInt_AS_LONG( arg );
+    if( kind < CompareEquality || kind > CompareAlways )
+        return py_value_fail( "invalid compare kind" );
+    self->compare_kind = static_cast<uint8_t>( kind );
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+Member_get_access_counts( Member* self, void* ctxt )
+{
+    return Py_BuildValue( "(kk)", static_cast<unsigned long>( self->get_count ),
+                          static_cast<unsigned long>( self->set_count ) );
+}
+
+
+static PyObject*
+Member_reset_access_counts( Member* self )
+{
+    self->get_count = 0;
+    self->set_count = 0;
     Py_RETURN_NONE;
 }
 
@@ -899,6 +1390,23 @@ Member_set_validate_default( Member* self, PyObject* arg )
 }
 
 
+static PyObject*
+Member_get_enum_canonical( Member* self, void* ctxt )
+{
+    return get_member_flag( self, MemberEnumCanonical );
+}
+
+
+static PyObject*
+Member_set_enum_canonical( Member* self, PyObject* arg )
+{
+    if( !PyBool_Check( arg ) )
+        return py_expected_type_fail( arg, "bool" );
+    set_member_flag( self, MemberEnumCanonical, arg == Py_True ? true : false );
+    Py_RETURN_NONE;
+}
+
+
 static PyGetSetDef
 Member_getset[] = {
     { "name", ( getter )Member_get_name, 0,
@@ -913,6 +1421,12 @@ Member_getset[] = {
       "Get the post validate kind for the member." },
     { "validate_default", ( getter )Member_get_validate_default, 0,
       "Whether or not the default value will be validated by the member" },
+    { "enum_canonical", ( getter )Member_get_enum_canonical, 0,
+      "Whether an enum stores the matching item instead of the assigned value." },
+    { "compare_kind", ( getter )Member_get_compare_kind, 0,
+      "Get the kind of comparison used to detect a change of value." },
+    { "access_counts", ( getter )Member_get_access_counts, 0,
+      "Get the (gets, sets) counted while access profiling is enabled." },
     { 0 } // sentinel
 };
 
@@ -931,6 +1445,8 @@ Member_methods[] = {
       "Add the name of a method to call on all atoms when the member changes." },
     { "remove_static_observer", ( PyCFunction )Member_remove_static_observer, METH_O,
       "Remove the name of a method to call on all atoms when the member changes." },
+    { "resolve_static_observers", ( PyCFunction )Member_resolve_static_observers, METH_O,
+      "Resolve the static observer names to the functions defined on the given type." },
     { "do_default", ( PyCFunction )Member_do_default, METH_O,
       "Run the default value handler for member." },
     { "do_validate", ( PyCFunction )Member_do_validate, METH_VARARGS,
@@ -955,6 +1471,12 @@ Member_methods[] = {
       "Set the index to which the member is bound. Use with extreme caution!" },
     { "set_validate_default", ( PyCFunction )Member_set_validate_default, METH_O,
       "Set whether or not to validate the default value." },
+    { "set_enum_canonical", ( PyCFunction )Member_set_enum_canonical, METH_O,
+      "Set whether an enum stores the matching item instead of the assigned value." },
+    { "set_compare_kind", ( PyCFunction )Member_set_compare_kind, METH_O,
+      "Set the kind of comparison used to detect a change of value." },
+    { "reset_access_counts", ( PyCFunction )Member_reset_access_counts, METH_NOARGS,
+      "Reset the access counts of the member to zero." },
     { 0 } // sentinel
 };
 
@@ -1015,20 +1537,20 @@ notify_observers( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& k
 {
     if( !get_atom_notify_bit( atom ) )
         return 0;
+    if( notify_queue_enabled() )
+        return notify_queue_push( member, atom, args, kwargs );
+    return dispatch_observers( member, atom, args, kwargs );
+}
+
+
+int
+dispatch_observers( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& kwargs )
+{
     if( member->static_observers )
     {
-        PyObjectPtr ownerptr( newref( reinterpret_cast<PyObject*>( atom ) ) );
-        StaticModifyGuard guard( member );
-        std::vector<PyObjectPtr>::iterator it;
-        std::vector<PyObjectPtr>::iterator end = member->static_observers->end();
-        for( it = member->static_observers->begin(); it != end; ++it )
-        {
-            PyObjectPtr method( ownerptr.get_attr( *it ) );
-            if( !method )
-                return -1;
-            if( !method( args, kwargs ) )
-                return -1;
-        }
+        PyObject* owner = reinterpret_cast<PyObject*>( atom );
+        if( call_static_observers( member, owner, args, kwargs ) < 0 )
+            return -1;
     }
     if( atom->observers )
     {
@@ -1046,6 +1568,9 @@ PyObject* _py_null;
 PyObject* _undefined;
 
 
+int member_access_profiling = 0;
+
+
 int import_member()
 {
     if( PyType_Ready( &PyNull_Type ) < 0 )
@@ -5,6 +5,7 @@
 #pragma once
 #include <vector>
 #include "pythonhelpers.h"
+#include "smallvector.h"
 #include "catom.h"
 
 
@@ -36,6 +37,14 @@ enum ValidateKind
     ValidateEnum,
     ValidateCallable,
     ValidateRange,
+    ValidateLongRange,
+    ValidateFloatRange,
+    ValidateCoerced,
+    ValidateRound,
+    ValidateStrip,
+    ValidatePipeline,
+    ValidateStrConstrained,
+    ValidateUnicodeConstrained,
     ValidateOwnerMethod,
     UserValidate                // keep this last
 };
@@ -61,9 +70,19 @@ enum DefaultKind
 };
 
 
+enum CompareKind
+{
+    CompareEquality,            // keep this first
+    CompareIdentity,
+    CompareNative,
+    CompareAlways               // keep this last
+};
+
+
 enum MemberFlag
 {
     MemberValidateDefault = 0x1,
+    MemberEnumCanonical = 0x2,      // an enum stores the matching item
 };
 
 
@@ -81,22 +100,100 @@ typedef struct {
 } MemberChange;
 
 
-class StaticModifyGuard;
+struct _Member;
 
 
-typedef struct {
+// Store a value for the member on an atom whose storage is known to
+// include the member index, then notify the observers of the change.
+typedef int
+( *member_setter )( struct _Member* member, CAtom* atom, PyObject* value );
+
+
+struct StaticObserverCache;
+
+
+// The static observer names of a member. A clone shares the block of
+// the member it was cloned from, and a member copies the block before
+// modifying it if it is shared with other members. Most members have
+// one or two observers, which are stored without a second allocation.
+struct StaticObservers
+{
+    StaticObservers() : refcount( 1 ) {}
+    typedef SmallVector<PyObjectPtr, 2> Names;
+    uint32_t refcount;
+    Names names;  // method names on the atom subclass
+};
+
+
+enum ValidateParamsFlag
+{
+    ParamsHasLow = 0x1,
+    ParamsHasHigh = 0x2,
+    ParamsClamp = 0x4,          // clip an out of range value to the bound
+    ParamsIntern = 0x8,         // intern the validated string
+    ParamsPromote = 0x10,       // promote a str to unicode
+};
+
+
+// The native parameters of a validate kind. They are parsed from the
+// validate context when the kind is set, so that validation does not
+// unpack and convert the context on every call.
+struct ValidateParams
+{
+    ValidateParams() :
+        flags( 0 ), ilow( 0 ), ihigh( 0 ), flow( 0.0 ), fhigh( 0.0 ), digits( 0 ),
+        intern_limit( 0 ) {}
+    uint32_t flags;                             // ValidateParamsFlag
+    long ilow;                                  // int and long bounds or string lengths
+    long ihigh;
+    double flow;                                // float bounds
+    double fhigh;
+    int digits;                                 // rounding precision
+    Py_ssize_t intern_limit;                    // intern table size to sweep at
+};
+
+
+// The concrete types most recently accepted by an Instance member. The
+// types are borrowed and are validated by their version tags, so an
+// entry is ignored once its type or one of its bases is modified.
+struct TypeCheckCache
+{
+    enum { Size = 4 };
+    TypeCheckCache() : next( 0 )
+    {
+        for( int i = 0; i < Size; ++i )
+        {
+            types[ i ] = 0;
+            version_tags[ i ] = 0;
+        }
+    }
+    PyTypeObject* types[ Size ];
+    unsigned int version_tags[ Size ];
+    uint32_t next;                              // the entry replaced next
+};
+
+
+typedef struct _Member {
     PyObject_HEAD
     uint32_t index;
     uint32_t flags;
+    uint32_t get_count;                         // recorded by the access profiler
+    uint32_t set_count;
+    uint8_t default_kind;                       // DefaultKind
+    uint8_t validate_kind;                      // ValidateKind
+    uint8_t post_validate_kind;                 // PostValidateKind
+    uint8_t compare_kind;                       // CompareKind
+    uint8_t modify_guard;                       // set by StaticModifyGuard
     PyObject* name;
-    DefaultKind default_kind;
-    ValidateKind validate_kind;
-    PostValidateKind post_validate_kind;
     PyObject* default_context;
     PyObject* validate_context;
+    PyObject* validate_cache;                   // derived from the validate context
     PyObject* post_validate_context;
-    std::vector<PyObjectPtr>* static_observers; // method names on the atom subclass
-    StaticModifyGuard* modify_guard;
+    StaticObservers* static_observers;          // shared copy-on-write
+    StaticObserverCache* static_cache;          // static observers resolved per type
+    TypeCheckCache* type_cache;                 // types accepted by an Instance
+    ValidateParams* validate_params;            // parsed from the validate context
+    member_setter setter;                       // selected by member_update_setter
 } Member;
 
 
@@ -105,21 +202,24 @@ class StaticModifyGuard
 
 public:
 
-    StaticModifyGuard( Member* member ) : m_member( member )
+    StaticModifyGuard( Member* member ) : m_member( 0 )
     {
-        if( m_member && !m_member->modify_guard )
-            m_member->modify_guard = this;
+        if( member && !member->modify_guard )
+        {
+            member->modify_guard = 1;
+            m_member = member;
+        }
     }
 
     ~StaticModifyGuard()
     {
-        if( m_member && m_member->modify_guard == this )
+        if( m_member )
             m_member->modify_guard = 0;
     }
 
 private:
 
-    Member* m_member;
+    Member* m_member;  // set if this guard is the outermost one
 
 };
 
@@ -128,6 +228,20 @@ PyObject*
 MemberChange_New( PyObject* object, PyObject* name, PyObject* oldval, PyObject* newval );
 
 
+// Create the 1-tuple of arguments for a change notification. The tuple
+// and the change it holds are reused from a previous notification when
+// possible. Returns a new reference, or null on failure.
+PyObject*
+member_change_args( PyObject* object, PyObject* name, PyObject* oldval, PyObject* newval );
+
+
+// Release the arguments created by 'member_change_args'. If no one
+// else holds a reference to the tuple or the change, both are kept
+// for reuse instead of being freed.
+void
+release_member_change_args( PyObjectPtr& args );
+
+
 PyObject*
 member_validate( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue  );
 
@@ -140,10 +254,58 @@ PyObject*
 member_default( Member* member, PyObject* owner );
 
 
+// The fully general setter which handles every validate kind, post
+// validate kind, and a null or deleted value.
+int
+member_set_generic( Member* member, CAtom* atom, PyObject* value );
+
+
+// Store the lookup structure derived from the validate context of the
+// member. The cache is released whenever the validate kind is changed.
+void
+member_set_validate_cache( Member* member, PyObject* cache );
+
+
+void
+member_clear_type_cache( Member* member );
+
+
+// Parse the native parameters for a validate kind and context. The
+// parameters are null for a kind which does not use them. Returns -1
+// and sets an exception if the context is invalid for the kind.
+int
+member_parse_validate_params( uint8_t kind, PyObject* context, ValidateParams*& params );
+
+
+// Notify the static and dynamic observers after the member value has
+// been changed from 'oldptr' to 'newptr'. Either may be null.
+int
+member_notify_change( Member* member, CAtom* atom, PyObjectPtr& oldptr, PyObjectPtr& newptr );
+
+
+// Whether the values are equal according to the compare kind of the
+// member, in which case a change between them is not reported.
+bool
+member_values_equal( Member* member, PyObjectPtr& oldptr, PyObjectPtr& newptr );
+
+
+// Select the setter specialized for the current validate and post
+// validate kinds of the member. This must be called whenever either
+// of the kinds is changed.
+void
+member_update_setter( Member* member );
+
+
 int
 notify_observers( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& kwargs );
 
 
+// Invoke the static and dynamic observers immediately, bypassing the
+// atom notify bit and the deferred notification queue.
+int
+dispatch_observers( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& kwargs );
+
+
 int import_member();
 
 
@@ -159,6 +321,10 @@ extern PyTypeObject Member_Type;
 extern PyTypeObject MemberChange_Type;
 
 
+// Non-zero while the member accesses are being counted.
+extern int member_access_profiling;
+
+
 inline int
 Member_Check( PyObject* object )
 {
@@ -166,5 +332,21 @@ Member_Check( PyObject* object )
 }
 
 
+inline void
+member_count_get( Member* member )
+{
+    if( member_access_profiling && member->get_count != 0xffffffff )
+        ++member->get_count;
+}
+
+
+inline void
+member_count_set( Member* member )
+{
+    if( member_access_profiling && member->set_count != 0xffffffff )
+        ++member->set_count;
+}
+
+
 }  // extern C
 
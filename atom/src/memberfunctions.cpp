@@ -2,7 +2,14 @@
 |  Copyright (c) 2013, Enthought, Inc.
 |  All rights reserved.
 |----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <climits>
 #include "member.h"
+#include "atomlist.h"
+#include "atomdict.h"
+#include "containerchange.h"
 
 
 typedef PyObject*
@@ -155,134 +162,302 @@ validate_tuple( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* n
 }
 
 
+// Whether the items accepted by the source validator are known to be
+// accepted unchanged by the target validator. This holds for equivalent
+// members whose validation depends only on the item, and not on the
+// owner or on per-instance state. Either member may be null, which
+// validates nothing.
+static bool
+validates_same( Member* source, Member* target )
+{
+    if( !target )
+        return true;
+    if( !source )
+        return false;
+    if( source != target && ( source->ob_type != target->ob_type ||
+        source->validate_kind != target->validate_kind ||
+        source->validate_context != target->validate_context ) )
+        return false;
+    if( target->post_validate_kind != NoPostValidate )
+        return false;
+    switch( target->validate_kind )
+    {
+        case ValidateList:
+        case ValidateDict:
+        case ValidatePipeline:
+        case ValidateOwnerMethod:
+        case UserValidate:
+            return false;
+        default:
+            return true;
+    }
+}
+
+
+// Whether every item of the container was validated by the validator.
+// This holds for a container marked as validated by validate_list or
+// validate_dict while it is owned, since all the changes made to it are
+// validated until then. A default container is not marked, since the
+// items of the default are not validated.
+static inline bool
+container_validated( bool validated, CAtom* owner, Member* validator, Member* target )
+{
+    return validated && owner && validates_same( validator, target );
+}
+
+
 static PyObject*
 validate_list( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
 {
     if( !PyList_Check( newvalue ) )
         return validate_type_fail( member, owner, newvalue, "list" );
-    Py_ssize_t size = PyList_GET_SIZE( newvalue );
-    PyObjectPtr listcopy( PyList_GetSlice( newvalue, 0, size ) );
-    if( !listcopy )
-        return 0;
+    Member* item_member = 0;
     if( member->validate_context != Py_None )
     {
         if( !Member_Check( member->validate_context ) )
             return py_bad_internal_call( "validate_list() context is not a Member or None" );
-        Member* item_member = reinterpret_cast<Member*>( member->validate_context );
+        item_member = reinterpret_cast<Member*>( member->validate_context );
+    }
+    // A list which was validated for this member or for an equivalent
+    // member does not need its items validated again. Assigning the
+    // current value to itself keeps it as-is.
+    bool validated = !item_member;
+    if( !validated && AtomList_Check( newvalue ) )
+    {
+        AtomList* source = reinterpret_cast<AtomList*>( newvalue );
+        validated = container_validated(
+            source->validated, source->owner, source->validator, item_member );
+        if( validated && newvalue == oldvalue && source->member == member &&
+            reinterpret_cast<PyObject*>( source->owner ) == owner )
+            return newref( newvalue );
+    }
+    // The items are copied into an AtomList, which validates the items
+    // added later and reports its changes to the observers of the member,
+    // without a proxy around the stored value.
+    Py_ssize_t size = PyList_GET_SIZE( newvalue );
+    PyObjectPtr listcopy( AtomList_New( size, member, item_member ) );
+    if( !listcopy )
+        return 0;
+    reinterpret_cast<AtomList*>( listcopy.get() )->validated = true;
+    if( validated )
+    {
         for( Py_ssize_t i = 0; i < size; ++i )
-        {
-            PyObject* item = PyList_GET_ITEM( listcopy.get(), i );
-            PyObject* valid_item = member_validate( item_member, owner, _py_null, item );
-            if( !valid_item )
-                return 0;
-            if( valid_item != item )
-                PyList_SetItem( listcopy.get(), i, valid_item ); // this steals the owned ref gained by member_validate
-        }
+            PyList_SET_ITEM( listcopy.get(), i, newref( PyList_GET_ITEM( newvalue, i ) ) );
+        return listcopy.release();
+    }
+    // A validator may modify the source list, so a snapshot is used.
+    PyObjectPtr items( PyList_GetSlice( newvalue, 0, size ) );
+    if( !items )
+        return 0;
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* item = PyList_GET_ITEM( items.get(), i );
+        PyObject* valid_item = member_validate( item_member, owner, _py_null, item );
+        if( !valid_item )
+            return 0;
+        PyList_SET_ITEM( listcopy.get(), i, valid_item );
     }
     return listcopy.release();
 }
 
 
-static PyObject*
-validate_dict_key_value( Member* keymember, Member* valmember, PyObject* owner, PyObject* dict )
+// Get the key and value members from the context of a dict member. A
+// member which is None in the context is returned as null.
+static bool
+dict_validators( Member* member, Member*& keymember, Member*& valmember )
 {
-    PyObject* key;
-    PyObject* value;
-    Py_ssize_t pos = 0;
-    PyDictPtr newptr( PyDict_New() );
-    if( !newptr )
-        return 0;
-    while( PyDict_Next( dict, &pos, &key, &value ) )
+    PyObject* context = member->validate_context;
+    if( !context || !PyTuple_Check( context ) || PyTuple_GET_SIZE( context ) != 2 )
     {
-        PyObjectPtr keyptr( member_validate( keymember, owner, _py_null, key ) );
-        if( !keyptr )
-            return 0;
-        PyObjectPtr valptr( member_validate( valmember, owner, _py_null, value ) );
-        if( !valptr )
-            return 0;
-        if( !newptr.set_item( keyptr, valptr ) )
-            return 0;
+        py_bad_internal_call( "validate_dict() context is not a 2-tuple" );
+        return false;
     }
-    return newptr.release();
+    PyObject* key = PyTuple_GET_ITEM( context, 0 );
+    PyObject* value = PyTuple_GET_ITEM( context, 1 );
+    if( key != Py_None && !Member_Check( key ) )
+    {
+        py_bad_internal_call( "validate_dict() context key is not a Member or None" );
+        return false;
+    }
+    if( value != Py_None && !Member_Check( value ) )
+    {
+        py_bad_internal_call( "validate_dict() context value is not a Member or None" );
+        return false;
+    }
+    keymember = key != Py_None ? reinterpret_cast<Member*>( key ) : 0;
+    valmember = value != Py_None ? reinterpret_cast<Member*>( value ) : 0;
+    return true;
 }
 
 
 static PyObject*
-validate_dict_value( Member* valmember, PyObject* owner, PyObject* dict )
+validate_dict( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
 {
-    PyObject* key;
-    PyObject* value;
-    Py_ssize_t pos = 0;
-    PyDictPtr newptr( PyDict_New() );
+    if( !PyDict_Check( newvalue ) )
+        return validate_type_fail( member, owner, newvalue, "dict" );
+    Member* keymember;
+    Member* valmember;
+    if( !dict_validators( member, keymember, valmember ) )
+        return 0;
+    // A dict which was validated for equivalent key and value members
+    // is copied without validating its items again.
+    bool validated = !keymember && !valmember;
+    if( !validated && AtomDict_Check( newvalue ) )
+    {
+        AtomDict* source = reinterpret_cast<AtomDict*>( newvalue );
+        validated = container_validated(
+            source->validated, source->owner, source->key_validator, keymember ) &&
+            validates_same( source->value_validator, valmember );
+        if( validated && newvalue == oldvalue && source->member == member &&
+            reinterpret_cast<PyObject*>( source->owner ) == owner )
+            return newref( newvalue );
+    }
+    // The items are validated into an AtomDict, which validates the
+    // items added later and reports its changes to the observers of
+    // the member, without a proxy around the stored value.
+    PyObjectPtr newptr( AtomDict_New( member, keymember, valmember ) );
     if( !newptr )
         return 0;
-    while( PyDict_Next( dict, &pos, &key, &value ) )
+    if( validated )
     {
-        PyObjectPtr keyptr( newref( key ) );
-        PyObjectPtr valptr( member_validate( valmember, owner, _py_null, value ) );
-        if( !valptr )
-            return 0;
-        if( !newptr.set_item( keyptr, valptr ) )
+        if( PyDict_Update( newptr.get(), newvalue ) < 0 )
             return 0;
+        reinterpret_cast<AtomDict*>( newptr.get() )->validated = true;
+        return newptr.release();
     }
-    return newptr.release();
-}
-
-
-static PyObject*
-validate_dict_key( Member* keymember, PyObject* owner, PyObject* dict )
-{
     PyObject* key;
     PyObject* value;
     Py_ssize_t pos = 0;
-    PyDictPtr newptr( PyDict_New() );
-    if( !newptr )
-        return 0;
-    while( PyDict_Next( dict, &pos, &key, &value ) )
+    while( PyDict_Next( newvalue, &pos, &key, &value ) )
     {
-        PyObjectPtr keyptr( member_validate( keymember, owner, _py_null, key ) );
-        if( !keyptr )
-            return 0;
+        PyObjectPtr keyptr( newref( key ) );
+        if( keymember )
+        {
+            keyptr = member_validate( keymember, owner, _py_null, key );
+            if( !keyptr )
+                return 0;
+        }
         PyObjectPtr valptr( newref( value ) );
-        if( !newptr.set_item( keyptr, valptr ) )
+        if( valmember )
+        {
+            valptr = member_validate( valmember, owner, _py_null, value );
+            if( !valptr )
+                return 0;
+        }
+        if( PyDict_SetItem( newptr.get(), keyptr.get(), valptr.get() ) != 0 )
             return 0;
     }
+    reinterpret_cast<AtomDict*>( newptr.get() )->validated = true;
     return newptr.release();
 }
 
 
-static PyObject*
-validate_dict( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+static PyObject* _instancecheck_str;
+
+
+static PyObject* _type_instancecheck;  // type.__instancecheck__
+
+
+static PyObject* _abc_instancecheck;   // ABCMeta.__instancecheck__
+
+
+static bool
+init_type_checks()
 {
-    if( !PyDict_Check( newvalue ) )
-        return validate_type_fail( member, owner, newvalue, "dict" );
-    if( !PyTuple_Check( member->validate_context ) )
-        return py_bad_internal_call( "validate_dict() context is not a 2-tuple" );
-    if( PyTuple_GET_SIZE( member->validate_context ) != 2 )
-        return py_bad_internal_call( "validate_dict() context is not a 2-tuple" );
-    PyObject* keymember = PyTuple_GET_ITEM( member->validate_context, 0 );
-    PyObject* valmember = PyTuple_GET_ITEM( member->validate_context, 1 );
-    if( keymember != Py_None && !Member_Check( keymember ) )
-        return py_bad_internal_call( "validate_dict() context key is not a Member or None" );
-    if( valmember != Py_None && !Member_Check( valmember ) )
-        return py_bad_internal_call( "validate_dict() context value is not a Member or None" );
-    if( keymember != Py_None && valmember != Py_None )
+    if( _instancecheck_str )
+        return true;
+    PyObjectPtr name( PyString_InternFromString( "__instancecheck__" ) );
+    if( !name )
+        return false;
+    PyObjectPtr abc( PyImport_ImportModule( "abc" ) );
+    if( !abc )
+        return false;
+    PyObjectPtr abcmeta( PyObject_GetAttrString( abc.get(), "ABCMeta" ) );
+    if( !abcmeta )
+        return false;
+    if( !PyType_Check( abcmeta.get() ) )
     {
-        Member* k = reinterpret_cast<Member*>( keymember );
-        Member* v = reinterpret_cast<Member*>( valmember );
-        return validate_dict_key_value( k, v, owner, newvalue );
+        py_type_fail( "abc.ABCMeta is not a type" );
+        return false;
     }
-    if( valmember != Py_None )
+    PyTypeObject* abctype = reinterpret_cast<PyTypeObject*>( abcmeta.get() );
+    _type_instancecheck = xnewref( _PyType_Lookup( &PyType_Type, name.get() ) );
+    _abc_instancecheck = xnewref( _PyType_Lookup( abctype, name.get() ) );
+    _instancecheck_str = name.release();
+    return true;
+}
+
+
+// Whether every instance of the type is an instance of the kind, so
+// that the type can be accepted without checking each value. This is
+// known for a type kind with the default instance check, and for an
+// abstract base class, whose registry only ever grows. Returns -1 on
+// error.
+static int
+type_always_accepted( PyTypeObject* type, PyObject* kind )
+{
+    if( !PyType_Check( kind ) )
+        return 0;
+    PyObject* check = _PyType_Lookup( kind->ob_type, _instancecheck_str );  // borrowed
+    if( check == _type_instancecheck )
+        return PyType_IsSubtype( type, reinterpret_cast<PyTypeObject*>( kind ) ) ? 1 : 0;
+    if( check && check == _abc_instancecheck )
+        return PyObject_IsSubclass( reinterpret_cast<PyObject*>( type ), kind );
+    return 0;
+}
+
+
+static bool
+type_check_cached( Member* member, PyTypeObject* type )
+{
+    TypeCheckCache* cache = member->type_cache;
+    if( !cache )
+        return false;
+    for( int i = 0; i < TypeCheckCache::Size; ++i )
     {
-        Member* v = reinterpret_cast<Member*>( valmember );
-        return validate_dict_value( v, owner, newvalue );
+        if( cache->types[ i ] == type &&
+            PyType_HasFeature( type, Py_TPFLAGS_VALID_VERSION_TAG ) &&
+            cache->version_tags[ i ] == type->tp_version_tag )
+            return true;
     }
-    if( keymember != Py_None )
+    return false;
+}
+
+
+// Add the type of a value accepted by the kinds of a member to the
+// cache of the member, if every instance of the type will be accepted.
+// The kinds are a type or tuple of types held by the validate context.
+static int
+type_check_add( Member* member, PyTypeObject* type, PyObject* kinds )
+{
+    if( !init_type_checks() )
+        return -1;
+    PyObjectPtr context( newref( member->validate_context ) );
+    int res = 0;
+    if( PyTuple_Check( kinds ) )
     {
-        Member* k = reinterpret_cast<Member*>( keymember );
-        return validate_dict_key( k, owner, newvalue );
+        Py_ssize_t size = PyTuple_GET_SIZE( kinds );
+        for( Py_ssize_t i = 0; i < size && res == 0; ++i )
+            res = type_always_accepted( type, PyTuple_GET_ITEM( kinds, i ) );
     }
-    return PyDict_Copy( newvalue );
+    else
+        res = type_always_accepted( type, kinds );
+    if( res <= 0 )
+        return res;
+    // _PyType_Lookup assigns the version tag when the type supports it.
+    _PyType_Lookup( type, _instancecheck_str );
+    if( !PyType_HasFeature( type, Py_TPFLAGS_VALID_VERSION_TAG ) )
+        return 0;
+    // The subclass check may have run code which changed the member.
+    if( member->validate_context != context.get() )
+        return 0;
+    if( !member->type_cache )
+        member->type_cache = new TypeCheckCache();
+    TypeCheckCache* cache = member->type_cache;
+    uint32_t slot = cache->next++ % TypeCheckCache::Size;
+    cache->types[ slot ] = type;
+    cache->version_tags[ slot ] = type->tp_version_tag;
+    return 0;
 }
 
 
@@ -291,11 +466,19 @@ validate_instance( Member* member, PyObject* owner, PyObject* oldvalue, PyObject
 {
     if( newvalue == Py_None )
         return newref( newvalue );
+    // The types which were accepted before are checked with a pointer
+    // compare, which skips __instancecheck__ and the subclass walk.
+    if( type_check_cached( member, newvalue->ob_type ) )
+        return newref( newvalue );
     int res = PyObject_IsInstance( newvalue, member->validate_context );
     if( res < 0 )
         return 0;
     if( res == 1 )
+    {
+        if( type_check_add( member, newvalue->ob_type, member->validate_context ) < 0 )
+            return 0;
         return newref( newvalue );
+    }
     return py_type_fail( "invalid instance type" );
 }
 
@@ -314,14 +497,81 @@ validate_typed( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* n
 }
 
 
+// Get the cached dict which maps each enum item to the index of its
+// first occurrence, building it on first use. Py_None is returned if
+// the items are not a tuple of hashable objects. Returns a borrowed
+// reference, or null on error.
+static PyObject*
+enum_index_map( Member* member )
+{
+    if( member->validate_cache )
+        return member->validate_cache;
+    PyObject* items = member->validate_context;
+    PyObjectPtr map( newref( Py_None ) );
+    if( PyTuple_Check( items ) )
+    {
+        PyObjectPtr dict( PyDict_New() );
+        if( !dict )
+            return 0;
+        Py_ssize_t size = PyTuple_GET_SIZE( items );
+        for( Py_ssize_t i = 0; i < size; ++i )
+        {
+            PyObject* item = PyTuple_GET_ITEM( items, i );
+            int res = PyDict_Contains( dict.get(), item );
+            if( res < 0 )
+                break;
+            if( res == 1 )
+                continue;
+            PyObjectPtr index( PyInt_FromSsize_t( i ) );
+            if( !index || PyDict_SetItem( dict.get(), item, index.get() ) < 0 )
+                break;
+        }
+        if( !PyErr_Occurred() )
+            map = dict;
+        else if( PyErr_ExceptionMatches( PyExc_TypeError ) )
+            PyErr_Clear();  // an unhashable item
+        else
+            return 0;
+    }
+    member_set_validate_cache( member, map.get() );
+    return member->validate_cache;
+}
+
+
 static PyObject*
 validate_enum( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
 {
-    int res = PySequence_Contains( member->validate_context, newvalue );
-    if( res < 0 )
+    PyObject* map = enum_index_map( member );
+    if( !map )
         return 0;
-    if( res == 1 )
-        return newref( newvalue );
+    PyObject* items = member->validate_context;
+    bool canonical = ( member->flags & MemberEnumCanonical ) != 0;
+    if( map != Py_None )
+    {
+        PyObject* index = PyDict_GetItem( map, newvalue );  // borrowed
+        if( index )
+        {
+            if( canonical )
+                return newref( PyTuple_GET_ITEM( items, PyInt_AS_LONG( index ) ) );
+            return newref( newvalue );
+        }
+    }
+    // A miss falls back to comparing the value with each item, which
+    // handles unhashable values and a hash inconsistent with equality.
+    // Valid values rarely take this path.
+    PyObjectPtr seq( PySequence_Fast( items, "enum items must be a sequence" ) );
+    if( !seq )
+        return 0;
+    Py_ssize_t size = PySequence_Fast_GET_SIZE( seq.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        PyObject* item = PySequence_Fast_GET_ITEM( seq.get(), i );
+        int res = PyObject_RichCompareBool( newvalue, item, Py_EQ );
+        if( res < 0 )
+            return 0;
+        if( res == 1 )
+            return newref( canonical ? item : newvalue );
+    }
     return py_value_fail( "invalid enum value" );
 }
 
@@ -335,36 +585,521 @@ validate_callable( Member* member, PyObject* owner, PyObject* oldvalue, PyObject
 }
 
 
+static PyObject*
+range_fail( bool too_small )
+{
+    return py_type_fail( too_small ? "range value too small" : "range value too large" );
+}
+
+
 static PyObject*
 validate_range( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
 {
     if( !PyInt_Check( newvalue ) )
         return validate_type_fail( member, owner, newvalue, "int" );
-    if( !PyTuple_Check( member->validate_context ) )
-        return py_bad_internal_call( "validate_range() context is not a 2-tuple" );
-    if( PyTuple_GET_SIZE( member->validate_context ) != 2 )
-        return py_bad_internal_call( "validate_range() context is not a 2-tuple" );
-    PyObject* low = PyTuple_GET_ITEM( member->validate_context, 0 );
-    PyObject* high = PyTuple_GET_ITEM( member->validate_context, 1 );
+    ValidateParams* params = member->validate_params;
+    if( !params )
+        return py_bad_internal_call( "validate_range() parameters are not set" );
     long value = PyInt_AS_LONG( newvalue );
-    if( low != Py_None )
+    bool below = ( params->flags & ParamsHasLow ) && value < params->ilow;
+    bool above = ( params->flags & ParamsHasHigh ) && value > params->ihigh;
+    if( !below && !above )
+        return newref( newvalue );
+    if( !( params->flags & ParamsClamp ) )
+        return range_fail( below );
+    return PyInt_FromLong( below ? params->ilow : params->ihigh );
+}
+
+
+static PyObject*
+validate_long_range( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    long value;
+    int overflow = 0;
+    if( PyInt_Check( newvalue ) )
+        value = PyInt_AS_LONG( newvalue );
+    else if( PyLong_Check( newvalue ) )
     {
-        if( !PyInt_Check( low ) )
-            return py_bad_internal_call( "validate_range() low is not an int" );
-        if( PyInt_AS_LONG( low ) > value )
-            return py_type_fail( "range value too small" );
+        value = PyLong_AsLongAndOverflow( newvalue, &overflow );
+        if( value == -1 && PyErr_Occurred() )
+            return 0;
     }
-    if( high != Py_None )
+    else
+        return validate_type_fail( member, owner, newvalue, "long" );
+    ValidateParams* params = member->validate_params;
+    if( !params )
+        return py_bad_internal_call( "validate_long_range() parameters are not set" );
+    // A value which overflows a C long is beyond either bound.
+    bool below = ( params->flags & ParamsHasLow ) &&
+        ( overflow < 0 || ( overflow == 0 && value < params->ilow ) );
+    bool above = ( params->flags & ParamsHasHigh ) &&
+        ( overflow > 0 || ( overflow == 0 && value > params->ihigh ) );
+    if( below || above )
     {
-        if( !PyInt_Check( high ) )
-            return py_bad_internal_call( "validate_range() high is not an int" );
-        if( PyInt_AS_LONG( high ) < value )
-            return py_type_fail( "range value too large" );
+        if( !( params->flags & ParamsClamp ) )
+            return range_fail( below );
+        return PyLong_FromLong( below ? params->ilow : params->ihigh );
     }
+    if( PyInt_Check( newvalue ) )
+        return PyLong_FromLong( value );
     return newref( newvalue );
 }
 
 
+static PyObject*
+validate_float_range( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    double value;
+    if( PyFloat_Check( newvalue ) )
+        value = PyFloat_AS_DOUBLE( newvalue );
+    else if( PyInt_Check( newvalue ) )
+        value = static_cast<double>( PyInt_AS_LONG( newvalue ) );
+    else if( PyLong_Check( newvalue ) )
+    {
+        value = PyLong_AsDouble( newvalue );
+        if( value == -1.0 && PyErr_Occurred() )
+            return 0;
+    }
+    else
+        return validate_type_fail( member, owner, newvalue, "float" );
+    ValidateParams* params = member->validate_params;
+    if( !params )
+        return py_bad_internal_call( "validate_float_range() parameters are not set" );
+    if( Py_IS_NAN( value ) && ( params->flags & ( ParamsHasLow | ParamsHasHigh ) ) )
+        return py_type_fail( "range value is not a number" );
+    bool below = ( params->flags & ParamsHasLow ) && value < params->flow;
+    bool above = ( params->flags & ParamsHasHigh ) && value > params->fhigh;
+    if( below || above )
+    {
+        if( !( params->flags & ParamsClamp ) )
+            return range_fail( below );
+        return PyFloat_FromDouble( below ? params->flow : params->fhigh );
+    }
+    if( PyFloat_Check( newvalue ) )
+        return newref( newvalue );
+    return PyFloat_FromDouble( value );
+}
+
+
+// Parse a range bound which is None or a number. The bound of an int
+// or long range must fit in a C long.
+static int
+parse_range_bound( uint8_t kind, PyObject* bound, uint32_t flag, long& ivalue,
+                   double& fvalue, ValidateParams* params )
+{
+    if( bound == Py_None )
+        return 0;
+    if( kind == ValidateFloatRange )
+    {
+        if( !PyFloat_Check( bound ) && !PyInt_Check( bound ) && !PyLong_Check( bound ) )
+        {
+            py_expected_type_fail( bound, "float, int, long or None" );
+            return -1;
+        }
+        fvalue = PyFloat_AsDouble( bound );
+        if( fvalue == -1.0 && PyErr_Occurred() )
+            return -1;
+        if( Py_IS_NAN( fvalue ) )
+        {
+            py_value_fail( "a range bound cannot be nan" );
+            return -1;
+        }
+    }
+    else
+    {
+        if( !PyInt_Check( bound ) && !PyLong_Check( bound ) )
+        {
+            py_expected_type_fail( bound, "int, long or None" );
+            return -1;
+        }
+        ivalue = PyInt_AsLong( bound );
+        if( ivalue == -1 && PyErr_Occurred() )
+            return -1;
+    }
+    params->flags |= flag;
+    return 0;
+}
+
+
+// Parse the (min_len, max_len, pattern, intern[, promote]) context of
+// a constrained string. The pattern is None or a compiled pattern.
+static int
+parse_string_params( uint8_t kind, PyObject* context, ValidateParams*& params )
+{
+    if( !PyTuple_Check( context ) ||
+        ( PyTuple_GET_SIZE( context ) != 4 && PyTuple_GET_SIZE( context ) != 5 ) )
+    {
+        py_type_fail( "string context must be a tuple of "
+                      "(min_len, max_len, pattern, intern[, promote])" );
+        return -1;
+    }
+    ValidateParams parsed;
+    double unused;
+    if( parse_range_bound( kind, PyTuple_GET_ITEM( context, 0 ), ParamsHasLow,
+                           parsed.ilow, unused, &parsed ) < 0 )
+        return -1;
+    if( parse_range_bound( kind, PyTuple_GET_ITEM( context, 1 ), ParamsHasHigh,
+                           parsed.ihigh, unused, &parsed ) < 0 )
+        return -1;
+    PyObject* pattern = PyTuple_GET_ITEM( context, 2 );
+    if( pattern != Py_None && !PyObject_HasAttrString( pattern, "match" ) )
+    {
+        py_expected_type_fail( pattern, "compiled pattern or None" );
+        return -1;
+    }
+    const uint32_t flags[] = { ParamsIntern, ParamsPromote };
+    for( Py_ssize_t i = 3; i < PyTuple_GET_SIZE( context ); ++i )
+    {
+        int res = PyObject_IsTrue( PyTuple_GET_ITEM( context, i ) );
+        if( res < 0 )
+            return -1;
+        if( res )
+            parsed.flags |= flags[ i - 3 ];
+    }
+    params = new ValidateParams( parsed );
+    return 0;
+}
+
+
+int
+member_parse_validate_params( uint8_t kind, PyObject* context, ValidateParams*& params )
+{
+    params = 0;
+    if( kind == ValidatePipeline )
+    {
+        if( !PyTuple_Check( context ) )
+        {
+            py_expected_type_fail( context, "tuple of Members" );
+            return -1;
+        }
+        for( Py_ssize_t i = 0; i < PyTuple_GET_SIZE( context ); ++i )
+        {
+            if( !Member_Check( PyTuple_GET_ITEM( context, i ) ) )
+            {
+                py_expected_type_fail( PyTuple_GET_ITEM( context, i ), "Member" );
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if( kind == ValidateRound )
+    {
+        if( !PyInt_Check( context ) )
+        {
+            py_expected_type_fail( context, "int" );
+            return -1;
+        }
+        params = new ValidateParams();
+        params->digits = static_cast<int>( std::max<long>(
+            std::min<long>( PyInt_AS_LONG( context ), INT_MAX ), INT_MIN ) );
+        return 0;
+    }
+    if( kind == ValidateStrConstrained || kind == ValidateUnicodeConstrained )
+        return parse_string_params( kind, context, params );
+    if( kind != ValidateRange && kind != ValidateLongRange && kind != ValidateFloatRange )
+        return 0;
+    // The context is (low, high) or (low, high, clamp).
+    if( !PyTuple_Check( context ) ||
+        ( PyTuple_GET_SIZE( context ) != 2 && PyTuple_GET_SIZE( context ) != 3 ) )
+    {
+        py_type_fail( "range context must be a tuple of (low, high[, clamp])" );
+        return -1;
+    }
+    // The params are parsed on the stack and copied out on success.
+    ValidateParams parsed;
+    if( parse_range_bound( kind, PyTuple_GET_ITEM( context, 0 ), ParamsHasLow,
+                           parsed.ilow, parsed.flow, &parsed ) < 0 )
+        return -1;
+    if( parse_range_bound( kind, PyTuple_GET_ITEM( context, 1 ), ParamsHasHigh,
+                           parsed.ihigh, parsed.fhigh, &parsed ) < 0 )
+        return -1;
+    if( PyTuple_GET_SIZE( context ) == 3 )
+    {
+        int clamp = PyObject_IsTrue( PyTuple_GET_ITEM( context, 2 ) );
+        if( clamp < 0 )
+            return -1;
+        if( clamp )
+            parsed.flags |= ParamsClamp;
+    }
+    params = new ValidateParams( parsed );
+    return 0;
+}
+
+
+static PyObject*
+validate_coerced( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    PyObject* context = member->validate_context;
+    if( !PyTuple_Check( context ) || PyTuple_GET_SIZE( context ) != 2 )
+        return py_bad_internal_call( "validate_coerced() context is not a 2-tuple" );
+    PyObject* kind = PyTuple_GET_ITEM( context, 0 );
+    PyObject* coercer = PyTuple_GET_ITEM( context, 1 );
+    // A value of an allowed type is accepted as-is, using the same type
+    // cache as an Instance member.
+    if( type_check_cached( member, newvalue->ob_type ) )
+        return newref( newvalue );
+    int res = PyObject_IsInstance( newvalue, kind );
+    if( res < 0 )
+        return 0;
+    if( res == 1 )
+    {
+        if( type_check_add( member, newvalue->ob_type, kind ) < 0 )
+            return 0;
+        return newref( newvalue );
+    }
+    PyObjectPtr callable( newref( coercer != Py_None ? coercer : kind ) );
+    PyObject* coerced = PyObject_CallFunctionObjArgs( callable.get(), newvalue, 0 );
+    if( !coerced && ( PyErr_ExceptionMatches( PyExc_TypeError ) ||
+                      PyErr_ExceptionMatches( PyExc_ValueError ) ) )
+    {
+        PyErr_Clear();
+        return py_type_fail( "could not coerce value an appopriate type" );
+    }
+    return coerced;
+}
+
+
+static PyObject*
+validate_round( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    double value;
+    if( PyFloat_Check( newvalue ) )
+        value = PyFloat_AS_DOUBLE( newvalue );
+    else if( PyInt_Check( newvalue ) )
+        value = static_cast<double>( PyInt_AS_LONG( newvalue ) );
+    else if( PyLong_Check( newvalue ) )
+    {
+        value = PyLong_AsDouble( newvalue );
+        if( value == -1.0 && PyErr_Occurred() )
+            return 0;
+    }
+    else
+        return validate_type_fail( member, owner, newvalue, "float" );
+    ValidateParams* params = member->validate_params;
+    if( !params )
+        return py_bad_internal_call( "validate_round() parameters are not set" );
+    // The same rounding as the builtin round(), including its guards
+    // for values and digits which _Py_double_round does not handle.
+    static const int ndigits_max = static_cast<int>( ( DBL_MANT_DIG - DBL_MIN_EXP ) * 0.30103 );
+    static const int ndigits_min = -static_cast<int>( ( DBL_MAX_EXP + 1 ) * 0.30103 );
+    if( !Py_IS_FINITE( value ) || value == 0.0 || params->digits > ndigits_max )
+        return PyFloat_FromDouble( value );
+    if( params->digits < ndigits_min )
+        return PyFloat_FromDouble( 0.0 * value );
+#ifndef PY_NO_SHORT_FLOAT_REPR
+    return _Py_double_round( value, params->digits );
+#else
+    // _Py_double_round is only defined with the short float repr, so
+    // the builtin is called instead.
+    PyObject* round = PyDict_GetItemString( PyEval_GetBuiltins(), "round" );  // borrowed
+    if( !round )
+        return py_bad_internal_call( "validate_round() builtin round is not found" );
+    return PyObject_CallFunction( round, "di", value, params->digits );
+#endif
+}
+
+
+static PyObject*
+validate_strip( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    if( PyString_Check( newvalue ) )
+    {
+        const char* data = PyString_AS_STRING( newvalue );
+        Py_ssize_t start = 0;
+        Py_ssize_t end = PyString_GET_SIZE( newvalue );
+        while( start < end && isspace( Py_CHARMASK( data[ start ] ) ) )
+            ++start;
+        while( end > start && isspace( Py_CHARMASK( data[ end - 1 ] ) ) )
+            --end;
+        if( start == 0 && end == PyString_GET_SIZE( newvalue ) )
+            return newref( newvalue );
+        return PyString_FromStringAndSize( data + start, end - start );
+    }
+    if( PyUnicode_Check( newvalue ) )
+    {
+        const Py_UNICODE* data = PyUnicode_AS_UNICODE( newvalue );
+        Py_ssize_t start = 0;
+        Py_ssize_t end = PyUnicode_GET_SIZE( newvalue );
+        while( start < end && Py_UNICODE_ISSPACE( data[ start ] ) )
+            ++start;
+        while( end > start && Py_UNICODE_ISSPACE( data[ end - 1 ] ) )
+            --end;
+        if( start == 0 && end == PyUnicode_GET_SIZE( newvalue ) )
+            return newref( newvalue );
+        return PyUnicode_FromUnicode( data + start, end - start );
+    }
+    return validate_type_fail( member, owner, newvalue, "basestring" );
+}
+
+
+static PyObject*
+validate_pipeline( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    // Each step is a member whose validate kind is applied to the value
+    // returned by the previous step. The context is checked to be a
+    // tuple of members when the kind is set. A pipeline which contains
+    // itself, directly or through a nested pipeline, is stopped by the
+    // recursion limit.
+    if( Py_EnterRecursiveCall( " in a validator pipeline" ) )
+        return 0;
+    PyObjectPtr steps( newref( member->validate_context ) );
+    PyObjectPtr value( newref( newvalue ) );
+    Py_ssize_t size = PyTuple_GET_SIZE( steps.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        Member* step = reinterpret_cast<Member*>( PyTuple_GET_ITEM( steps.get(), i ) );
+        value = member_validate( step, owner, oldvalue, value.get() );
+        if( !value )
+            break;
+    }
+    Py_LeaveRecursiveCall();
+    return value.release();
+}
+
+
+// Get the cached tuple of (match, table) for a constrained string
+// member, building it on first use. The match is the bound match method
+// of the pattern, or None. The table is the dict of interned unicode
+// values, or None. Returns a borrowed reference, or null on error.
+static PyObject*
+string_cache( Member* member )
+{
+    if( member->validate_cache )
+        return member->validate_cache;
+    PyObject* pattern = PyTuple_GET_ITEM( member->validate_context, 2 );
+    PyObjectPtr match( newref( Py_None ) );
+    if( pattern != Py_None )
+    {
+        match = PyObject_GetAttrString( pattern, "match" );
+        if( !match )
+            return 0;
+    }
+    PyObjectPtr table( newref( Py_None ) );
+    if( member->validate_kind == ValidateUnicodeConstrained &&
+        ( member->validate_params->flags & ParamsIntern ) )
+    {
+        table = PyDict_New();
+        if( !table )
+            return 0;
+    }
+    PyObjectPtr cache( PyTuple_Pack( 2, match.get(), table.get() ) );
+    if( !cache )
+        return 0;
+    member_set_validate_cache( member, cache.get() );
+    return member->validate_cache;
+}
+
+
+// Check the length and pattern of a string value. The value is stolen
+// and returned on success.
+static PyObject*
+validate_string_constraints( Member* member, PyObject* value, Py_ssize_t size )
+{
+    PyObjectPtr valueptr( value );
+    ValidateParams* params = member->validate_params;
+    if( ( params->flags & ParamsHasLow ) && size < params->ilow )
+        return py_type_fail( "string value too short" );
+    if( ( params->flags & ParamsHasHigh ) && size > params->ihigh )
+        return py_type_fail( "string value too long" );
+    PyObject* cache = string_cache( member );
+    if( !cache )
+        return 0;
+    PyObject* match = PyTuple_GET_ITEM( cache, 0 );
+    if( match != Py_None )
+    {
+        PyObjectPtr res( PyObject_CallFunctionObjArgs( match, value, 0 ) );
+        if( !res )
+            return 0;
+        if( res.get() == Py_None )
+            return py_type_fail( "string value does not match the pattern" );
+    }
+    return valueptr.release();
+}
+
+
+static PyObject*
+validate_str_constrained( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    if( !PyString_Check( newvalue ) )
+        return validate_type_fail( member, owner, newvalue, "string" );
+    if( !member->validate_params )
+        return py_bad_internal_call( "validate_str_constrained() parameters are not set" );
+    PyObject* value = validate_string_constraints(
+        member, newref( newvalue ), PyString_GET_SIZE( newvalue ) );
+    // Only exact strings can be interned. The interned string is mortal,
+    // and is released once no atom holds it.
+    if( value && ( member->validate_params->flags & ParamsIntern ) && PyString_CheckExact( value ) )
+        PyString_InternInPlace( &value );
+    return value;
+}
+
+
+// Remove the values which are only referenced by the intern table,
+// so that the table only holds values which are still in use. The
+// table is swept whenever it doubles in size, which keeps the cost
+// amortized over the insertions.
+static int
+sweep_intern_table( PyObject* table )
+{
+    PyObjectPtr unused( PyList_New( 0 ) );
+    if( !unused )
+        return -1;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while( PyDict_Next( table, &pos, &key, &value ) )
+    {
+        // The key and the value are the same object.
+        if( key == value && key->ob_refcnt == 2 && PyList_Append( unused.get(), key ) < 0 )
+            return -1;
+    }
+    Py_ssize_t size = PyList_GET_SIZE( unused.get() );
+    for( Py_ssize_t i = 0; i < size; ++i )
+    {
+        if( PyDict_DelItem( table, PyList_GET_ITEM( unused.get(), i ) ) < 0 )
+            return -1;
+    }
+    return 0;
+}
+
+
+static PyObject*
+validate_unicode_constrained( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
+{
+    ValidateParams* params = member->validate_params;
+    if( !params )
+        return py_bad_internal_call( "validate_unicode_constrained() parameters are not set" );
+    PyObjectPtr value;
+    if( PyUnicode_Check( newvalue ) )
+        value = newref( newvalue );
+    else if( PyString_Check( newvalue ) && ( params->flags & ParamsPromote ) )
+        value = PyUnicode_FromObject( newvalue );
+    else
+        return validate_type_fail( member, owner, newvalue, "unicode" );
+    if( !value )
+        return 0;
+    Py_ssize_t size = PyUnicode_GET_SIZE( value.get() );
+    value = validate_string_constraints( member, value.release(), size );
+    if( !value || !( params->flags & ParamsIntern ) || !PyUnicode_CheckExact( value.get() ) )
+        return value.release();
+    // Unicode has no builtin interning, so equal values share the first
+    // one stored in the table of the member.
+    PyObject* table = PyTuple_GET_ITEM( member->validate_cache, 1 );
+    PyObject* interned = PyDict_GetItem( table, value.get() );
+    if( interned )
+        return newref( interned );
+    if( PyDict_Size( table ) >= params->intern_limit )
+    {
+        if( sweep_intern_table( table ) < 0 )
+            return 0;
+        params->intern_limit = std::max<Py_ssize_t>( 2 * PyDict_Size( table ), 64 );
+    }
+    if( PyDict_SetItem( table, value.get(), value.get() ) < 0 )
+        return 0;
+    return value.release();
+}
+
+
 static PyObject*
 validate_owner_method( Member* member, PyObject* owner, PyObject* oldvalue, PyObject* newvalue )
 {
@@ -424,6 +1159,14 @@ validators[] = {
     validate_enum,
     validate_callable,
     validate_range,
+    validate_long_range,
+    validate_float_range,
+    validate_coerced,
+    validate_round,
+    validate_strip,
+    validate_pipeline,
+    validate_str_constrained,
+    validate_unicode_constrained,
     validate_owner_method,
     user_validate
 };
@@ -509,23 +1252,54 @@ default_value( Member* member, PyObject* owner )
 static PyObject*
 default_list( Member* member, PyObject* owner )
 {
-    if( member->default_context == Py_None )
-        return PyList_New( 0 );
-    if( !PyList_Check( member->default_context ) )
+    PyObject* context = member->default_context;
+    if( context != Py_None && !PyList_Check( context ) )
         return py_type_fail( "expect a list as default context" );
-    Py_ssize_t size = PyList_GET_SIZE( member->default_context );
-    return PyList_GetSlice( member->default_context, 0, size );
+    Py_ssize_t size = context == Py_None ? 0 : PyList_GET_SIZE( context );
+    // The default of a List is an AtomList, so that the items added to
+    // it are validated and its changes are reported.
+    if( member->validate_kind == ValidateList )
+    {
+        Member* item_member = 0;
+        if( member->validate_context && Member_Check( member->validate_context ) )
+            item_member = reinterpret_cast<Member*>( member->validate_context );
+        PyObject* listcopy = AtomList_New( size, member, item_member );
+        if( !listcopy )
+            return 0;
+        for( Py_ssize_t i = 0; i < size; ++i )
+            PyList_SET_ITEM( listcopy, i, newref( PyList_GET_ITEM( context, i ) ) );
+        return listcopy;
+    }
+    if( context == Py_None )
+        return PyList_New( 0 );
+    return PyList_GetSlice( context, 0, size );
 }
 
 
 static PyObject*
 default_dict( Member* member, PyObject* owner )
 {
-    if( member->default_context == Py_None )
-        return PyDict_New();
-    if( !PyDict_Check( member->default_context ) )
+    PyObject* context = member->default_context;
+    if( context != Py_None && !PyDict_Check( context ) )
         return py_type_fail( "expect a dict as default context" );
-    return PyDict_Copy( member->default_context );
+    // The default of a Dict is an AtomDict, so that the items added to
+    // it are validated and its changes are reported.
+    if( member->validate_kind == ValidateDict )
+    {
+        Member* keymember;
+        Member* valmember;
+        if( !dict_validators( member, keymember, valmember ) )
+            return 0;
+        PyObjectPtr dict( AtomDict_New( member, keymember, valmember ) );
+        if( !dict )
+            return 0;
+        if( context != Py_None && PyDict_Update( dict.get(), context ) < 0 )
+            return 0;
+        return dict.release();
+    }
+    if( context == Py_None )
+        return PyDict_New();
+    return PyDict_Copy( context );
 }
 
 
@@ -594,3 +1368,93 @@ member_default( Member* member, PyObject* owner )
     return defaults[ member->default_kind ]( member, owner );
 }
 
+
+
+// The validators have internal linkage, which C++98 does not allow
+// for a template argument. The generic setter is used in that case.
+#if __cplusplus >= 201103L
+
+// A setter specialized at compile time for a validator. The validator
+// is a template argument so that the compiler can inline it, leaving
+// a straight-line path for members without post validation. A null or
+// deleted value is handed to the generic setter.
+template<validate_func Validate>
+static int
+member_set_validated( Member* member, CAtom* atom, PyObject* value )
+{
+    if( !value || value == _py_null )
+        return member_set_generic( member, atom, value );
+    PyObject* oldvalue = atom->data[ member->index ];
+    if( oldvalue == value )
+        return 0;
+    // The validator may run Python code which replaces the value in the
+    // slot, so an owned reference to the old value is held across it.
+    PyObjectPtr oldptr( xnewref( oldvalue ) );      // take owned ref
+    PyObject* owner = reinterpret_cast<PyObject*>( atom );
+    PyObjectPtr newptr( Validate( member, owner, oldvalue ? oldvalue : _py_null, value ) );
+    if( !newptr )
+        return -1;
+    if( newptr == _py_null )
+        newptr.decref_release();
+    container_released( atom, member, atom->data[ member->index ] );
+    Py_XDECREF( atom->data[ member->index ] );       // release internally owned ref
+    atom->data[ member->index ] = newptr.xnewref();  // take internally owned ref
+    container_stored( atom, member, newptr.get() );
+    return member_notify_change( member, atom, oldptr, newptr );
+}
+
+
+static member_setter
+setters[] = {
+    member_set_validated<no_validate>,
+    member_set_validated<validate_read_only>,
+    member_set_validated<validate_constant>,
+    member_set_validated<validate_bool>,
+    member_set_validated<validate_int>,
+    member_set_validated<validate_long>,
+    member_set_validated<validate_long_promote>,
+    member_set_validated<validate_float>,
+    member_set_validated<validate_float_promote>,
+    member_set_validated<validate_string>,
+    member_set_validated<validate_unicode>,
+    member_set_validated<validate_unicode_promote>,
+    member_set_validated<validate_tuple>,
+    member_set_validated<validate_list>,
+    member_set_validated<validate_dict>,
+    member_set_validated<validate_instance>,
+    member_set_validated<validate_typed>,
+    member_set_validated<validate_enum>,
+    member_set_validated<validate_callable>,
+    member_set_validated<validate_range>,
+    member_set_validated<validate_long_range>,
+    member_set_validated<validate_float_range>,
+    member_set_validated<validate_coerced>,
+    member_set_validated<validate_round>,
+    member_set_validated<validate_strip>,
+    member_set_validated<validate_pipeline>,
+    member_set_validated<validate_str_constrained>,
+    member_set_validated<validate_unicode_constrained>,
+    member_set_validated<validate_owner_method>,
+    member_set_validated<user_validate>
+};
+
+
+void
+member_update_setter( Member* member )
+{
+    size_t count = sizeof( setters ) / sizeof( member_setter );
+    if( member->post_validate_kind || static_cast<size_t>( member->validate_kind ) >= count )
+        member->setter = member_set_generic;
+    else
+        member->setter = setters[ member->validate_kind ];
+}
+
+#else
+
+void
+member_update_setter( Member* member )
+{
+    member->setter = member_set_generic;
+}
+
+#endif
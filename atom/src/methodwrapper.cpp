@@ -0,0 +1,218 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#include "methodwrapper.h"
+
+
+using namespace PythonHelpers;
+
+
+// The argument tuples with a length up to this value are recycled
+// between calls instead of being allocated for every notification.
+#define MAX_CACHED_ARGS 4
+
+
+extern "C" {
+
+
+static PyObject* args_cache[ MAX_CACHED_ARGS + 1 ];
+
+
+static PyObject*
+acquire_args( Py_ssize_t size )
+{
+    if( size <= MAX_CACHED_ARGS && args_cache[ size ] )
+    {
+        // The slot is emptied while the tuple is in use so that a
+        // reentrant call allocates a tuple of its own.
+        PyObject* cached = args_cache[ size ];
+        args_cache[ size ] = 0;
+        return cached;
+    }
+    return PyTuple_New( size );
+}
+
+
+static void
+release_args( PyObject* callargs )
+{
+    Py_ssize_t size = PyTuple_GET_SIZE( callargs );
+    if( callargs->ob_refcnt != 1 || size > MAX_CACHED_ARGS || args_cache[ size ] )
+    {
+        Py_DECREF( callargs );
+        return;
+    }
+    // The callee did not keep a reference to the tuple, so the items
+    // are released and the tuple is kept for the next call.
+    for( Py_ssize_t i = 0; i < size; ++i )
+        Py_CLEAR( PyTuple_GET_ITEM( callargs, i ) );
+    args_cache[ size ] = callargs;
+}
+
+
+PyObject*
+method_wrapper_invoke( MethodWrapper* self, PyObject* args, PyObject* kwargs )
+{
+    PyObject* im_self = PyWeakref_GET_OBJECT( self->im_selfref );
+    if( im_self == Py_None )
+        Py_RETURN_NONE;
+    if( !PyTuple_Check( args ) )
+        return py_bad_internal_call( "method wrapper args" );
+    Py_ssize_t size = PyTuple_GET_SIZE( args );
+    PyObject* callargs = acquire_args( size + 1 );
+    if( !callargs )
+        return 0;
+    PyTuple_SET_ITEM( callargs, 0, newref( im_self ) );
+    for( Py_ssize_t i = 0; i < size; ++i )
+        PyTuple_SET_ITEM( callargs, i + 1, newref( PyTuple_GET_ITEM( args, i ) ) );
+    PyObject* result = PyObject_Call( self->im_func, callargs, kwargs );
+    release_args( callargs );
+    return result;
+}
+
+
+static void
+MethodWrapper_dealloc( MethodWrapper* self )
+{
+    Py_CLEAR( self->im_selfref );
+    Py_CLEAR( self->im_func );
+    self->ob_type->tp_free( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+MethodWrapper__call__( MethodWrapper* self, PyObject* args, PyObject* kwargs )
+{
+    return method_wrapper_invoke( self, args, kwargs );
+}
+
+
+static PyObject*
+MethodWrapper_richcompare( MethodWrapper* self, PyObject* other, int op )
+{
+    if( op == Py_EQ )
+    {
+        if( PyMethod_Check( other ) && PyMethod_GET_SELF( other ) )
+        {
+            if( ( self->im_func == PyMethod_GET_FUNCTION( other ) ) &&
+                ( PyWeakref_GET_OBJECT( self->im_selfref ) == PyMethod_GET_SELF( other ) ) )
+                Py_RETURN_TRUE;
+            Py_RETURN_FALSE;
+        }
+        else if( MethodWrapper_Check( other ) )
+        {
+            MethodWrapper* wrapper = reinterpret_cast<MethodWrapper*>( other );
+            if( ( self->im_func == wrapper->im_func ) &&
+                ( self->im_selfref == wrapper->im_selfref ) )
+                Py_RETURN_TRUE;
+            Py_RETURN_FALSE;
+        }
+        else
+            Py_RETURN_FALSE;
+    }
+    Py_RETURN_NOTIMPLEMENTED;
+}
+
+
+static int
+MethodWrapper__nonzero__( MethodWrapper* self )
+{
+    return method_wrapper_alive( self ) ? 1 : 0;
+}
+
+
+PyNumberMethods MethodWrapper_as_number = {
+     ( binaryfunc )0,                       /* nb_add */
+     ( binaryfunc )0,                       /* nb_subtract */
+     ( binaryfunc )0,                       /* nb_multiply */
+     ( binaryfunc )0,                       /* nb_divide */
+     ( binaryfunc )0,                       /* nb_remainder */
+     ( binaryfunc )0,                       /* nb_divmod */
+     ( ternaryfunc )0,                      /* nb_power */
+     ( unaryfunc )0,                        /* nb_negative */
+     ( unaryfunc )0,                        /* nb_positive */
+     ( unaryfunc )0,                        /* nb_absolute */
+     ( inquiry )MethodWrapper__nonzero__    /* nb_nonzero */
+};
+
+
+PyTypeObject MethodWrapper_Type = {
+    PyObject_HEAD_INIT( &PyType_Type )
+    0,                                      /* ob_size */
+    "MethodWrapper",                        /* tp_name */
+    sizeof( MethodWrapper ),                /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    (destructor)MethodWrapper_dealloc,      /* tp_dealloc */
+    (printfunc)0,                           /* tp_print */
+    (getattrfunc)0,                         /* tp_getattr */
+    (setattrfunc)0,                         /* tp_setattr */
+    (cmpfunc)0,                             /* tp_compare */
+    (reprfunc)0,                            /* tp_repr */
+    (PyNumberMethods*)&MethodWrapper_as_number, /* tp_as_number */
+    (PySequenceMethods*)0,                  /* tp_as_sequence */
+    (PyMappingMethods*)0,                   /* tp_as_mapping */
+    (hashfunc)0,                            /* tp_hash */
+    (ternaryfunc)MethodWrapper__call__,     /* tp_call */
+    (reprfunc)0,                            /* tp_str */
+    (getattrofunc)0,                        /* tp_getattro */
+    (setattrofunc)0,                        /* tp_setattro */
+    (PyBufferProcs*)0,                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                     /* tp_flags */
+    0,                                      /* Documentation string */
+    (traverseproc)0,                        /* tp_traverse */
+    (inquiry)0,                             /* tp_clear */
+    (richcmpfunc)MethodWrapper_richcompare, /* tp_richcompare */
+    0,                                      /* tp_weaklistoffset */
+    (getiterfunc)0,                         /* tp_iter */
+    (iternextfunc)0,                        /* tp_iternext */
+    (struct PyMethodDef*)0,                 /* tp_methods */
+    (struct PyMemberDef*)0,                 /* tp_members */
+    0,                                      /* tp_getset */
+    0,                                      /* tp_base */
+    0,                                      /* tp_dict */
+    (descrgetfunc)0,                        /* tp_descr_get */
+    (descrsetfunc)0,                        /* tp_descr_set */
+    0,                                      /* tp_dictoffset */
+    (initproc)0,                            /* tp_init */
+    (allocfunc)PyType_GenericAlloc,         /* tp_alloc */
+    (newfunc)0,                             /* tp_new */
+    (freefunc)PyObject_Del,                 /* tp_free */
+    (inquiry)0,                             /* tp_is_gc */
+    0,                                      /* tp_bases */
+    0,                                      /* tp_mro */
+    0,                                      /* tp_cache */
+    0,                                      /* tp_subclasses */
+    0,                                      /* tp_weaklist */
+    (destructor)0                           /* tp_del */
+};
+
+
+PyObject*
+MethodWrapper_New( PyObject* method )
+{
+    if( !PyMethod_Check( method ) || !PyMethod_GET_SELF( method ) )
+        return py_expected_type_fail( method, "bound method" );
+    PyObjectPtr wr( PyWeakref_NewRef( PyMethod_GET_SELF( method ), 0 ) );
+    if( !wr )
+        return 0;
+    PyObject* pywrapper = PyType_GenericNew( &MethodWrapper_Type, 0, 0 );
+    if( !pywrapper )
+        return 0;
+    MethodWrapper* wrapper = reinterpret_cast<MethodWrapper*>( pywrapper );
+    wrapper->im_func = newref( PyMethod_GET_FUNCTION( method ) );
+    wrapper->im_selfref = wr.release();
+    return pywrapper;
+}
+
+
+int
+import_methodwrapper()
+{
+    if( PyType_Ready( &MethodWrapper_Type ) < 0 )
+        return -1;
+    return 0;
+}
+
+
+}  // extern C
@@ -0,0 +1,56 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+
+
+extern "C" {
+
+
+// An observer which holds a bound method as the underlying function
+// and a weak reference to the instance, so that observing an object
+// does not keep the owner of the method alive.
+typedef struct {
+    PyObject_HEAD
+    PyObject* im_func;
+    PyObject* im_selfref;
+} MethodWrapper;
+
+
+// Create a new wrapper for the given bound method.
+PyObject*
+MethodWrapper_New( PyObject* method );
+
+
+// Whether the instance which owns the method is still alive. This is
+// the same test performed by the wrapper's nb_nonzero slot.
+inline bool
+method_wrapper_alive( MethodWrapper* self )
+{
+    return PyWeakref_GET_OBJECT( self->im_selfref ) != Py_None;
+}
+
+
+// Invoke the underlying function with the instance prepended to the
+// arguments, without creating an intermediate bound method. Returns
+// a new reference to the result, or null on failure.
+PyObject*
+method_wrapper_invoke( MethodWrapper* self, PyObject* args, PyObject* kwargs );
+
+
+int import_methodwrapper();
+
+
+extern PyTypeObject MethodWrapper_Type;
+
+
+inline int
+MethodWrapper_Check( PyObject* object )
+{
+    return PyObject_TypeCheck( object, &MethodWrapper_Type );
+}
+
+
+}  // extern C
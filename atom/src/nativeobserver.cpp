@@ -0,0 +1,122 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#include "nativeobserver.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+static void
+NativeObserver_dealloc( NativeObserver* self )
+{
+    self->ob_type->tp_free( reinterpret_cast<PyObject*>( self ) );
+}
+
+
+static PyObject*
+NativeObserver__call__( NativeObserver* self, PyObject* args, PyObject* kwargs )
+{
+    if( native_observer_invoke( self, args, kwargs ) < 0 )
+        return 0;
+    Py_RETURN_NONE;
+}
+
+
+static PyObject*
+NativeObserver_richcompare( NativeObserver* self, PyObject* other, int op )
+{
+    if( op == Py_EQ )
+    {
+        if( NativeObserver_Check( other ) )
+        {
+            NativeObserver* native = reinterpret_cast<NativeObserver*>( other );
+            if( self->func == native->func && self->context == native->context )
+                Py_RETURN_TRUE;
+        }
+        Py_RETURN_FALSE;
+    }
+    Py_RETURN_NOTIMPLEMENTED;
+}
+
+
+PyTypeObject NativeObserver_Type = {
+    PyObject_HEAD_INIT( &PyType_Type )
+    0,                                      /* ob_size */
+    "NativeObserver",                       /* tp_name */
+    sizeof( NativeObserver ),               /* tp_basicsize */
+    0,                                      /* tp_itemsize */
+    (destructor)NativeObserver_dealloc,     /* tp_dealloc */
+    (printfunc)0,                           /* tp_print */
+    (getattrfunc)0,                         /* tp_getattr */
+    (setattrfunc)0,                         /* tp_setattr */
+    (cmpfunc)0,                             /* tp_compare */
+    (reprfunc)0,                            /* tp_repr */
+    (PyNumberMethods*)0,                    /* tp_as_number */
+    (PySequenceMethods*)0,                  /* tp_as_sequence */
+    (PyMappingMethods*)0,                   /* tp_as_mapping */
+    (hashfunc)0,                            /* tp_hash */
+    (ternaryfunc)NativeObserver__call__,    /* tp_call */
+    (reprfunc)0,                            /* tp_str */
+    (getattrofunc)0,                        /* tp_getattro */
+    (setattrofunc)0,                        /* tp_setattro */
+    (PyBufferProcs*)0,                      /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                     /* tp_flags */
+    0,                                      /* Documentation string */
+    (traverseproc)0,                        /* tp_traverse */
+    (inquiry)0,                             /* tp_clear */
+    (richcmpfunc)NativeObserver_richcompare, /* tp_richcompare */
+    0,                                      /* tp_weaklistoffset */
+    (getiterfunc)0,                         /* tp_iter */
+    (iternextfunc)0,                        /* tp_iternext */
+    (struct PyMethodDef*)0,                 /* tp_methods */
+    (struct PyMemberDef*)0,                 /* tp_members */
+    0,                                      /* tp_getset */
+    0,                                      /* tp_base */
+    0,                                      /* tp_dict */
+    (descrgetfunc)0,                        /* tp_descr_get */
+    (descrsetfunc)0,                        /* tp_descr_set */
+    0,                                      /* tp_dictoffset */
+    (initproc)0,                            /* tp_init */
+    (allocfunc)PyType_GenericAlloc,         /* tp_alloc */
+    (newfunc)0,                             /* tp_new */
+    (freefunc)PyObject_Del,                 /* tp_free */
+    (inquiry)0,                             /* tp_is_gc */
+    0,                                      /* tp_bases */
+    0,                                      /* tp_mro */
+    0,                                      /* tp_cache */
+    0,                                      /* tp_subclasses */
+    0,                                      /* tp_weaklist */
+    (destructor)0                           /* tp_del */
+};
+
+
+PyObject*
+NativeObserver_New( catom_observer_func func, void* context )
+{
+    if( !func )
+        return py_bad_internal_call( "native observer function is null" );
+    PyObject* pynative = PyType_GenericAlloc( &NativeObserver_Type, 0 );
+    if( !pynative )
+        return 0;
+    NativeObserver* native = reinterpret_cast<NativeObserver*>( pynative );
+    native->func = func;
+    native->context = context;
+    return pynative;
+}
+
+
+int
+import_nativeobserver()
+{
+    if( PyType_Ready( &NativeObserver_Type ) < 0 )
+        return -1;
+    return 0;
+}
+
+
+}  // extern C
@@ -0,0 +1,49 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+#ifndef CATOM_MODULE
+#define CATOM_MODULE
+#endif
+#include "catomapi.h"
+
+
+extern "C" {
+
+
+// An observer which invokes a C function pointer with a context
+// pointer, registered through the exported C API.
+typedef struct {
+    PyObject_HEAD
+    catom_observer_func func;
+    void* context;
+} NativeObserver;
+
+
+PyObject*
+NativeObserver_New( catom_observer_func func, void* context );
+
+
+inline int
+native_observer_invoke( NativeObserver* self, PyObject* args, PyObject* kwargs )
+{
+    return self->func( self->context, args, kwargs );
+}
+
+
+int import_nativeobserver();
+
+
+extern PyTypeObject NativeObserver_Type;
+
+
+inline int
+NativeObserver_Check( PyObject* object )
+{
+    return PyObject_TypeCheck( object, &NativeObserver_Type );
+}
+
+
+}  // extern C
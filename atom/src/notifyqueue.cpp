@@ -0,0 +1,294 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#ifdef __MINGW32__
+#include <stdint.h>
+#endif
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "notifyqueue.h"
+
+
+struct QueueEntry
+{
+    PyObjectPtr m_member;
+    PyObjectPtr m_atom;
+    PyObjectPtr m_args;
+    PyObjectPtr m_kwargs;
+};
+
+
+class NotifyQueue
+{
+
+    typedef std::pair<PyObject*, PyObject*> PendingKey;
+
+public:
+
+    NotifyQueue() :
+        m_ring( 16 ), m_head( 0 ), m_size( 0 ), m_cancelled( 0 ), m_popped( 0 ),
+        m_enabled( false ), m_coalesce( false ) {}
+
+    bool enabled() { return m_enabled; }
+
+    bool set_enabled( bool enabled, bool coalesce )
+    {
+        bool old = m_enabled;
+        m_enabled = enabled;
+        m_coalesce = enabled && coalesce;
+        if( !m_coalesce )
+            m_pending.clear();
+        return old;
+    }
+
+    // The number of entries waiting to be dispatched.
+    size_t size() { return m_size - m_cancelled; }
+
+    // Returns 1 if the entry was pushed, 0 if it was merged into a
+    // pending entry, and -1 on failure.
+    int push( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& kwargs )
+    {
+        PyObject* pymember = reinterpret_cast<PyObject*>( member );
+        PyObject* pyatom = reinterpret_cast<PyObject*>( atom );
+        bool mergeable = m_coalesce && !kwargs && is_change_args( args.get() );
+        if( mergeable )
+        {
+            int res = merge_pending( member, PendingKey( pyatom, pymember ), args );
+            if( res <= 0 )
+                return res;
+        }
+        else if( m_coalesce )
+        {
+            // Any other record, such as a container change, must be
+            // delivered after the pending change, so a later change
+            // may not be merged into that one.
+            m_pending.erase( PendingKey( pyatom, pymember ) );
+        }
+        if( m_size == m_ring.size() )
+            grow();
+        QueueEntry& entry( m_ring[ ( m_head + m_size ) & ( m_ring.size() - 1 ) ] );
+        entry.m_member = newref( pymember );
+        entry.m_atom = newref( pyatom );
+        entry.m_args = args.newref();
+        entry.m_kwargs = kwargs.xnewref();
+        if( mergeable )
+            m_pending[ PendingKey( pyatom, pymember ) ] = m_popped + m_size;
+        ++m_size;
+        return 1;
+    }
+
+    // Move the entry at the head of the queue into 'out', skipping the
+    // cancelled entries. The queue must not be empty.
+    void pop( QueueEntry& out )
+    {
+        while( !m_ring[ m_head ].m_args )
+        {
+            m_head = ( m_head + 1 ) & ( m_ring.size() - 1 );
+            --m_size;
+            --m_cancelled;
+            ++m_popped;
+        }
+        QueueEntry& entry( m_ring[ m_head ] );
+        if( m_coalesce )
+        {
+            PendingKey key( entry.m_atom.get(), entry.m_member.get() );
+            std::map<PendingKey, uint64_t>::iterator it = m_pending.find( key );
+            if( it != m_pending.end() && it->second == m_popped )
+                m_pending.erase( it );
+        }
+        transfer( entry, out );
+        m_head = ( m_head + 1 ) & ( m_ring.size() - 1 );
+        --m_size;
+        ++m_popped;
+    }
+
+private:
+
+    static bool is_change_args( PyObject* args )
+    {
+        return PyTuple_Check( args ) && PyTuple_GET_SIZE( args ) == 1 &&
+            PyObject_TypeCheck( PyTuple_GET_ITEM( args, 0 ), &MemberChange_Type );
+    }
+
+    static void transfer( QueueEntry& src, QueueEntry& dst )
+    {
+        dst.m_member = src.m_member.release();
+        dst.m_atom = src.m_atom.release();
+        dst.m_args = src.m_args.release();
+        dst.m_kwargs = src.m_kwargs.release();
+    }
+
+    QueueEntry& entry_at( uint64_t seq )
+    {
+        size_t offset = static_cast<size_t>( seq - m_popped );
+        return m_ring[ ( m_head + offset ) & ( m_ring.size() - 1 ) ];
+    }
+
+    // Merge the change into the pending change for the key, if any. A
+    // merged change which leaves the value equal to the pending old
+    // value is cancelled, since observers would see no change. Returns
+    // 0 if the change was merged, 1 if it must be pushed, and -1 on
+    // failure.
+    int merge_pending( Member* member, const PendingKey& key, PyObjectPtr& args )
+    {
+        std::map<PendingKey, uint64_t>::iterator it = m_pending.find( key );
+        if( it == m_pending.end() )
+            return 1;
+        uint64_t seq = it->second;
+        MemberChange* pending = reinterpret_cast<MemberChange*>(
+            PyTuple_GET_ITEM( entry_at( seq ).m_args.get(), 0 ) );
+        MemberChange* latest = reinterpret_cast<MemberChange*>(
+            PyTuple_GET_ITEM( args.get(), 0 ) );
+        PyObjectPtr oldptr( newref( pending->oldvalue ? pending->oldvalue : _py_null ) );
+        PyObjectPtr newptr( newref( latest->newvalue ? latest->newvalue : _py_null ) );
+        bool equal = member_values_equal( member, oldptr, newptr );
+        // The comparison may run Python code which modifies the queue,
+        // in which case the change is pushed as a new entry.
+        it = m_pending.find( key );
+        if( it == m_pending.end() || it->second != seq )
+            return 1;
+        if( !equal )
+            return merge( entry_at( seq ), args ) ? 0 : -1;
+        m_pending.erase( it );
+        cancel( seq );
+        return 0;
+    }
+
+    // Release the entry and leave it in the ring to be skipped by pop.
+    void cancel( uint64_t seq )
+    {
+        QueueEntry released;  // released on return, once the queue is consistent
+        transfer( entry_at( seq ), released );
+        ++m_cancelled;
+        if( m_cancelled == m_size )
+        {
+            m_head = ( m_head + m_size ) & ( m_ring.size() - 1 );
+            m_popped += m_size;
+            m_size = 0;
+            m_cancelled = 0;
+        }
+    }
+
+    // Replace the pending change with one which spans from the pending
+    // old value to the latest new value.
+    bool merge( QueueEntry& entry, PyObjectPtr& args )
+    {
+        MemberChange* pending = reinterpret_cast<MemberChange*>(
+            PyTuple_GET_ITEM( entry.m_args.get(), 0 ) );
+        MemberChange* latest = reinterpret_cast<MemberChange*>(
+            PyTuple_GET_ITEM( args.get(), 0 ) );
+        PyObjectPtr change( MemberChange_New(
+            latest->object, latest->name, pending->oldvalue, latest->newvalue ) );
+        if( !change )
+            return false;
+        PyTuplePtr argsptr( PyTuple_New( 1 ) );
+        if( !argsptr )
+            return false;
+        argsptr.initialize( 0, change );
+        entry.m_args = argsptr.release();
+        return true;
+    }
+
+    // The ring capacity is always a power of 2 so that the slot index
+    // can be computed with a mask instead of a division.
+    void grow()
+    {
+        std::vector<QueueEntry> ring( m_ring.size() * 2 );
+        for( size_t i = 0; i < m_size; ++i )
+            transfer( m_ring[ ( m_head + i ) & ( m_ring.size() - 1 ) ], ring[ i ] );
+        m_ring.swap( ring );
+        m_head = 0;
+    }
+
+    std::vector<QueueEntry> m_ring;
+    size_t m_head;
+    size_t m_size;       // including the cancelled entries
+    size_t m_cancelled;
+    uint64_t m_popped;  // used to map pending sequence numbers to ring slots
+    bool m_enabled;
+    bool m_coalesce;
+    std::map<PendingKey, uint64_t> m_pending;
+
+};
+
+
+// The queue lives for the life of the process. It is never destroyed
+// since that would decref objects after the interpreter is finalized.
+static NotifyQueue* queue = new NotifyQueue();
+static PyObject* queue_hook = 0;
+
+
+extern "C" {
+
+
+bool
+notify_queue_enabled()
+{
+    return queue->enabled();
+}
+
+
+bool
+notify_queue_set_enabled( bool enabled, bool coalesce )
+{
+    return queue->set_enabled( enabled, coalesce );
+}
+
+
+int
+notify_queue_push( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& kwargs )
+{
+    int res = queue->push( member, atom, args, kwargs );
+    if( res < 0 )
+        return -1;
+    if( res == 1 && queue->size() == 1 && queue_hook )
+    {
+        // The push happens after the member value is stored, so an
+        // error in the hook must not fail the set which queued it.
+        PyObjectPtr hook( newref( queue_hook ) );
+        PyObjectPtr result( PyObject_CallObject( hook.get(), 0 ) );
+        if( !result )
+            PyErr_WriteUnraisable( hook.get() );
+    }
+    return 0;
+}
+
+
+Py_ssize_t
+notify_queue_flush()
+{
+    Py_ssize_t count = 0;
+    while( queue->size() > 0 )
+    {
+        QueueEntry entry;
+        queue->pop( entry );
+        Member* member = reinterpret_cast<Member*>( entry.m_member.get() );
+        CAtom* atom = reinterpret_cast<CAtom*>( entry.m_atom.get() );
+        if( dispatch_observers( member, atom, entry.m_args, entry.m_kwargs ) < 0 )
+            return -1;
+        ++count;
+    }
+    return count;
+}
+
+
+Py_ssize_t
+notify_queue_size()
+{
+    return static_cast<Py_ssize_t>( queue->size() );
+}
+
+
+void
+notify_queue_set_hook( PyObject* hook )
+{
+    PyObject* old = queue_hook;
+    queue_hook = ( hook && hook != Py_None ) ? newref( hook ) : 0;
+    Py_XDECREF( old );
+}
+
+
+}  // extern "C"
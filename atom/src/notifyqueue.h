@@ -0,0 +1,58 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include "pythonhelpers.h"
+#include "catom.h"
+#include "member.h"
+
+
+using namespace PythonHelpers;
+
+
+extern "C" {
+
+
+// Whether notifications are currently being pushed onto the queue
+// instead of being dispatched synchronously to the observers.
+bool
+notify_queue_enabled();
+
+
+// Enable or disable deferred notification. When 'coalesce' is true,
+// pending changes for the same (atom, member) pair are merged so that
+// only the latest value is dispatched, and dropped when the latest
+// value equals the pending old value. Returns the previous state.
+bool
+notify_queue_set_enabled( bool enabled, bool coalesce );
+
+
+// Push a notification onto the queue. This takes new references to
+// all of the arguments. Returns 0 on success, -1 on failure.
+int
+notify_queue_push( Member* member, CAtom* atom, PyObjectPtr& args, PyObjectPtr& kwargs );
+
+
+// Dispatch the queued notifications in the order in which they were
+// pushed, including any notifications pushed by the observers during
+// the drain. Returns the number dispatched, or -1 on failure.
+Py_ssize_t
+notify_queue_flush();
+
+
+// The number of notifications waiting to be dispatched.
+Py_ssize_t
+notify_queue_size();
+
+
+// Set the callable which is invoked with no arguments whenever the
+// queue transitions from empty to non-empty. This is intended to be
+// used by an event loop to schedule a flush. An error raised by the
+// hook is reported as unraisable. A null or None callable removes the
+// hook.
+void
+notify_queue_set_hook( PyObject* hook );
+
+
+}  // extern "C"
@@ -3,6 +3,9 @@
 |  All rights reserved.
 |----------------------------------------------------------------------------*/
 #include "observerpool.h"
+#include "filteredobserver.h"
+#include "nativeobserver.h"
+#include "methodwrapper.h"
 
 
 struct ModifyTask
@@ -71,8 +74,8 @@ private:
 
 bool ObserverPool::has_topic( PyObjectPtr& topic )
 {
-    std::vector<Topic>::iterator topic_it;
-    std::vector<Topic>::iterator topic_end = m_topics.end();
+    TopicVector::iterator topic_it;
+    TopicVector::iterator topic_end = m_topics.end();
     for( topic_it = m_topics.begin(); topic_it != topic_end; ++topic_it )
     {
         if( topic_it->match( topic ) )
@@ -91,14 +94,14 @@ void ObserverPool::add( PyObjectPtr& topic, PyObjectPtr& observer )
         return;
     }
     uint32_t obs_offset = 0;
-    std::vector<Topic>::iterator topic_it;
-    std::vector<Topic>::iterator topic_end = m_topics.end();
+    TopicVector::iterator topic_it;
+    TopicVector::iterator topic_end = m_topics.end();
     for( topic_it = m_topics.begin(); topic_it != topic_end; ++topic_it )
     {
         if( topic_it->match( topic ) )
         {
-            std::vector<PyObjectPtr>::iterator obs_it;
-            std::vector<PyObjectPtr>::iterator obs_end;
+            ObserverVector::iterator obs_it;
+            ObserverVector::iterator obs_end;
             obs_it = m_observers.begin() + obs_offset;
             obs_end = obs_it + topic_it->m_count;
             for( ; obs_it != obs_end; ++obs_it )
@@ -126,26 +129,41 @@ void ObserverPool::remove( PyObjectPtr& topic, PyObjectPtr& observer )
         return;
     }
     uint32_t obs_offset = 0;
-    std::vector<Topic>::iterator topic_it;
-    std::vector<Topic>::iterator topic_end = m_topics.end();
+    TopicVector::iterator topic_it;
+    TopicVector::iterator topic_end = m_topics.end();
     for( topic_it = m_topics.begin(); topic_it != topic_end; ++topic_it )
     {
         if( topic_it->match( topic ) )
         {
-            std::vector<PyObjectPtr>::iterator obs_it;
-            std::vector<PyObjectPtr>::iterator obs_end;
+            ObserverVector::iterator obs_it;
+            ObserverVector::iterator obs_end;
             obs_it = m_observers.begin() + obs_offset;
             obs_end = obs_it + topic_it->m_count;
-            for( ; obs_it != obs_end; ++obs_it )
+            // A plain observer also removes every filtered wrapper of it,
+            // so that it can be removed without specifying the filters.
+            bool plain = !FilteredObserver_Check( observer.get() );
+            uint32_t removed = 0;
+            while( obs_it != obs_end )
             {
-                if( *obs_it == observer || obs_it->richcompare( observer, Py_EQ ) )
+                bool match = *obs_it == observer || obs_it->richcompare( observer, Py_EQ );
+                if( !match && plain && FilteredObserver_Check( obs_it->get() ) )
                 {
-                    m_observers.erase( obs_it );
-                    if( ( --topic_it->m_count ) == 0 )
-                        m_topics.erase( topic_it );
-                    return;
+                    PyObjectPtr wrapped( newref(
+                        reinterpret_cast<FilteredObserver*>( obs_it->get() )->observer ) );
+                    match = wrapped == observer || wrapped.richcompare( observer, Py_EQ );
+                }
+                if( match )
+                {
+                    m_observers.erase( obs_it );  // shifts the next item to obs_it
+                    --obs_end;
+                    ++removed;
                 }
+                else
+                    ++obs_it;
             }
+            topic_it->m_count -= removed;
+            if( topic_it->m_count == 0 )
+                m_topics.erase( topic_it );
             return;
         }
         obs_offset += topic_it->m_count;
@@ -157,21 +175,59 @@ int ObserverPool::notify( PyObjectPtr& topic, PyObjectPtr& args, PyObjectPtr& kw
 {
     ModifyGuard guard( *this );
     uint32_t obs_offset = 0;
-    std::vector<Topic>::iterator topic_it;
-    std::vector<Topic>::iterator topic_end = m_topics.end();
+    TopicVector::iterator topic_it;
+    TopicVector::iterator topic_end = m_topics.end();
     for( topic_it = m_topics.begin(); topic_it != topic_end; ++topic_it )
     {
         if( topic_it->match( topic ) )
         {
-            std::vector<PyObjectPtr>::iterator obs_it;
-            std::vector<PyObjectPtr>::iterator obs_end;
+            ObserverVector::iterator obs_it;
+            ObserverVector::iterator obs_end;
             obs_it = m_observers.begin() + obs_offset;
             obs_end = obs_it + topic_it->m_count;
             for( ; obs_it != obs_end; ++obs_it )
             {
-                if( obs_it->is_true() )
+                // Bound method observers are the common case. They are
+                // tested for liveness and invoked without going through
+                // the number protocol or creating a bound method.
+                if( Py_TYPE( obs_it->get() ) == &MethodWrapper_Type )
+                {
+                    MethodWrapper* wrapper = reinterpret_cast<MethodWrapper*>( obs_it->get() );
+                    if( method_wrapper_alive( wrapper ) )
+                    {
+                        PyObjectPtr res( method_wrapper_invoke( wrapper, args.get(), kwargs.get() ) );
+                        if( !res )
+                            return -1;
+                    }
+                    else
+                    {
+                        ModifyTask* task = new RemoveTask( *this, topic, *obs_it );
+                        m_modify_guard->add_task( task );
+                    }
+                }
+                else if( PyFunction_Check( obs_it->get() ) || obs_it->is_true() )
                 {
-                    if( !obs_it->operator()( args, kwargs ) )
+                    // Evaluate declarative filters natively so that a
+                    // rejected change never reaches the Python observer.
+                    if( FilteredObserver_Check( obs_it->get() ) )
+                    {
+                        FilteredObserver* filtered = reinterpret_cast<FilteredObserver*>( obs_it->get() );
+                        int res = filtered_observer_accepts( filtered, args.get(), kwargs.get() );
+                        if( res < 0 )
+                            return -1;
+                        if( res == 0 )
+                            continue;
+                        PyObjectPtr observer( newref( filtered->observer ) );
+                        if( !observer( args, kwargs ) )
+                            return -1;
+                    }
+                    else if( NativeObserver_Check( obs_it->get() ) )
+                    {
+                        NativeObserver* native = reinterpret_cast<NativeObserver*>( obs_it->get() );
+                        if( native_observer_invoke( native, args.get(), kwargs.get() ) < 0 )
+                            return -1;
+                    }
+                    else if( !obs_it->operator()( args, kwargs ) )
                         return -1;
                 }
                 else
@@ -191,16 +247,16 @@ int ObserverPool::notify( PyObjectPtr& topic, PyObjectPtr& args, PyObjectPtr& kw
 int ObserverPool::py_traverse( visitproc visit, void* arg )
 {
     int vret;
-    std::vector<Topic>::iterator topic_it;
-    std::vector<Topic>::iterator topic_end = m_topics.end();
+    TopicVector::iterator topic_it;
+    TopicVector::iterator topic_end = m_topics.end();
     for( topic_it = m_topics.begin(); topic_it != topic_end; ++topic_it )
     {
         vret = visit( topic_it->m_topic.get(), arg );
         if( vret )
             return vret;
     }
-    std::vector<PyObjectPtr>::iterator obs_it;
-    std::vector<PyObjectPtr>::iterator obs_end = m_observers.end();
+    ObserverVector::iterator obs_it;
+    ObserverVector::iterator obs_end = m_observers.end();
     for( obs_it = m_observers.begin(); obs_it != obs_end; ++obs_it )
     {
         vret = visit( obs_it->get(), arg );
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include "pythonhelpers.h"
+#include "smallvector.h"
 
 
 
@@ -24,9 +25,11 @@ class ObserverPool
 
     struct Topic
     {
+        Topic() : m_count( 0 ) {}
         Topic( PyObjectPtr& topic ) : m_topic( topic ), m_count( 0 ) {}
         Topic( PyObjectPtr& topic, uint32_t count ) : m_topic( topic ), m_count( count ) {}
-        ~Topic() {}
+        // No user declared destructor or copy operations, so that the
+        // compiler generates a move constructor for vector relocation.
         bool match( PyObjectPtr& topic )
         {
             return m_topic == topic || m_topic.richcompare( topic, Py_EQ );
@@ -53,9 +56,9 @@ public:
 
     Py_ssize_t py_sizeof()
     {
-        Py_ssize_t size = sizeof( ModifyGuard* );
-        size += sizeof( std::vector<Topic> ) + sizeof( Topic ) * m_topics.capacity();
-        size += sizeof( std::vector<PyObjectPtr> ) + sizeof( PyObjectPtr ) * m_observers.capacity();
+        Py_ssize_t size = sizeof( ObserverPool );
+        size += m_topics.heap_size();
+        size += m_observers.heap_size();
         return size;
     };
 
@@ -69,9 +72,14 @@ public:
 
 private:
 
+    // Most atoms are observed by one or two observers, which are held
+    // in the pool allocation itself.
+    typedef SmallVector<Topic, 2> TopicVector;
+    typedef SmallVector<PyObjectPtr, 2> ObserverVector;
+
     ModifyGuard* m_modify_guard;
-    std::vector<Topic> m_topics;
-    std::vector<PyObjectPtr> m_observers;
+    TopicVector m_topics;
+    ObserverVector m_observers;
     ObserverPool(const ObserverPool& other);
     ObserverPool& operator=(const ObserverPool&);
 
@@ -115,6 +115,16 @@ public:
 
     PyObjectPtr( PyObject* pyobj ) : m_pyobj( pyobj ) {}
 
+#if __cplusplus >= 201103L
+    // Moving a pointer transfers the reference without touching the
+    // refcount, and lets std::vector relocate its elements on growth,
+    // insertion and erasure without an incref/decref pair per element.
+    PyObjectPtr( PyObjectPtr&& objptr ) noexcept : m_pyobj( objptr.m_pyobj )
+    {
+        objptr.m_pyobj = 0;
+    }
+#endif
+
     ~PyObjectPtr()
     {
         xdecref_release();
@@ -342,6 +352,20 @@ public:
         return *this;
     }
 
+#if __cplusplus >= 201103L
+    PyObjectPtr& operator=( PyObjectPtr&& rhs ) noexcept
+    {
+        if( this != &rhs )
+        {
+            PyObject* old = m_pyobj;
+            m_pyobj = rhs.m_pyobj;
+            rhs.m_pyobj = 0;
+            Py_XDECREF( old );
+        }
+        return *this;
+    }
+#endif
+
 protected:
 
     PyObject* m_pyobj;
@@ -0,0 +1,132 @@
+/*-----------------------------------------------------------------------------
+|  Copyright (c) 2013, Enthought, Inc.
+|  All rights reserved.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#ifdef __MINGW32__
+#include <stdint.h>
+#endif
+
+
+// A vector which stores up to N items inline before allocating them
+// on the heap. The value type must be default constructible, and a
+// default constructed value must not own any resources, since the
+// unused inline slots are kept in that state. Only the operations
+// needed by the containers in this package are provided.
+template <typename T, size_t N>
+class SmallVector
+{
+
+public:
+
+    typedef T* iterator;
+
+    SmallVector() : m_data( m_inline ), m_size( 0 ), m_capacity( N ) {}
+
+    SmallVector( const SmallVector& other ) :
+        m_data( m_inline ), m_size( 0 ), m_capacity( N )
+    {
+        *this = other;
+    }
+
+    ~SmallVector()
+    {
+        if( m_data != m_inline )
+            delete[] m_data;
+    }
+
+    SmallVector& operator=( const SmallVector& other )
+    {
+        if( this == &other )
+            return *this;
+        clear();
+        reserve( other.m_size );
+        for( uint32_t i = 0; i < other.m_size; ++i )
+            m_data[ i ] = other.m_data[ i ];
+        m_size = other.m_size;
+        return *this;
+    }
+
+    iterator begin() { return m_data; }
+
+    iterator end() { return m_data + m_size; }
+
+    size_t size() const { return m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    size_t capacity() const { return m_capacity; }
+
+    // The number of bytes allocated on the heap for the items.
+    size_t heap_size() const
+    {
+        return m_data == m_inline ? 0 : sizeof( T ) * m_capacity;
+    }
+
+    T& operator[]( size_t index ) { return m_data[ index ]; }
+
+    T& back() { return m_data[ m_size - 1 ]; }
+
+    void reserve( size_t capacity )
+    {
+        if( capacity <= m_capacity )
+            return;
+        T* data = new T[ capacity ];
+        for( uint32_t i = 0; i < m_size; ++i )
+            std::swap( data[ i ], m_data[ i ] );
+        if( m_data != m_inline )
+            delete[] m_data;
+        m_data = data;
+        m_capacity = static_cast<uint32_t>( capacity );
+    }
+
+    void push_back( const T& value )
+    {
+        if( m_size == m_capacity )
+        {
+            // The value may be an item of this vector.
+            T item( value );
+            reserve( m_capacity * 2 );
+            std::swap( m_data[ m_size++ ], item );
+            return;
+        }
+        m_data[ m_size++ ] = value;
+    }
+
+    void insert( iterator pos, const T& value )
+    {
+        size_t index = pos - m_data;
+        push_back( value );
+        for( size_t i = m_size - 1; i > index; --i )
+            std::swap( m_data[ i ], m_data[ i - 1 ] );
+    }
+
+    void erase( iterator pos )
+    {
+        for( iterator it = pos + 1; it != end(); ++it )
+            std::swap( *( it - 1 ), *it );
+        m_data[ --m_size ] = T();
+    }
+
+    // Release the items, keeping the allocated capacity.
+    void clear()
+    {
+        // The items are moved out first since releasing an item may
+        // run arbitrary code which accesses the vector.
+        while( m_size > 0 )
+        {
+            T item;
+            std::swap( item, m_data[ --m_size ] );
+        }
+    }
+
+private:
+
+    T* m_data;
+    uint32_t m_size;
+    uint32_t m_capacity;
+    T m_inline[ N ];
+
+};
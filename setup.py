@@ -14,7 +14,15 @@ ext_modules = [
          'atom/src/memberfunctions.cpp',
          'atom/src/catommodule.cpp',
          'atom/src/signal.cpp',
-         'atom/src/event.cpp'],
+         'atom/src/event.cpp',
+         'atom/src/notifyqueue.cpp',
+         'atom/src/filteredobserver.cpp',
+         'atom/src/nativeobserver.cpp',
+         'atom/src/methodwrapper.cpp',
+         'atom/src/atommeta.cpp',
+         'atom/src/atomlist.cpp',
+         'atom/src/atomdict.cpp',
+         'atom/src/containerchange.cpp'],
         language='c++',
     ),
 ]